@@ -1,16 +1,33 @@
 // Library Management System
+#define _POSIX_C_SOURCE 200809L   // fseeko/ftello, nanosleep, localtime_r under -std=c99/c11
+#define _FILE_OFFSET_BITS 64        // 64-bit fseeko/ftello on 32-bit POSIX builds
+#define _DARWIN_C_SOURCE            // keeps flock() visible on macOS alongside the above
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #ifdef _WIN32
   #include <conio.h>
+  #include <direct.h>
+  #include <windows.h>
+  #define makeDir(p) _mkdir(p)
+  #define sleepMs(ms) Sleep(ms)
+  #define fseek64(f, o, w) _fseeki64((f), (o), (w))
+  #define ftell64(f) _ftelli64(f)
 #else
   #include <termios.h>
   #include <unistd.h>
+  #include <pthread.h>
+  #include <fcntl.h>
+  #include <sys/file.h>
+  #define makeDir(p) mkdir((p), 0755)
+  #define sleepMs(ms) nanosleep(&(struct timespec){ (ms) / 1000, ((ms) % 1000) * 1000000L }, NULL)
+  #define fseek64(f, o, w) fseeko((f), (off_t)(o), (w))
+  #define ftell64(f) ((long long)ftello(f))
   static int getch(void) {
       struct termios oldt, newt;
       int ch;
@@ -24,12 +41,49 @@
   }
 #endif
 
-#define DATA_FILE     "books.dat"
-#define STUDENT_FILE  "students.dat"
-#define ISSUE_FILE    "issues.dat"
+#define BRANCH_DIR    "branches"
+#define MAIN_BRANCH   "main"
+#define BRANCH_CODE_LEN 16
+#define MAX_BRANCHES  32
+#define PATH_LEN      160
 #define ADMIN_CFG     "admin.cfg"
 #define DEFAULT_ADMIN_PASS "admin123"
 #define FINE_PER_DAY 5
+#define FORMAT_FILE   "format.ver"
+#define DATA_FORMAT   2
+#define BOOK_INDEX    g_bookIndex
+#define STUDENT_INDEX g_studentIndex
+#define INDEX_MAGIC   0x49534D4Cu
+#define INDEX_VERSION 2
+#define INDEX_TAIL_RECS 64
+#define REPL_LOG      "changes.log"
+#define REPL_LOCK     "changes.lock"
+#define REPLICA_DIR   "replica"
+#define REPLICA_STATE "replica/replica.state"
+#define REPLICA_LOCK  "replica/replica.lock"
+#define REPL_MAGIC    0x474F4C52u
+#define REPL_VERSION  3
+#define REPL_MAX_BYTES (64LL << 20)   // trim or rotate changes.log past this
+#define REPL_MAX_WRITE 4096           // largest in-place record write
+#define REPLICA_MAX_LAG_SEC 5
+#define REPLICA_POLL_MS 1000
+
+// Each branch keeps its own data files; "main" lives in the working
+// directory, other branches under branches/<code>/. See selectBranch().
+static char g_root[PATH_LEN] = "";   // "" for the live data, REPLICA_DIR when reading the replica
+static char g_branch[BRANCH_CODE_LEN] = MAIN_BRANCH;
+static char g_branchCfg[PATH_LEN] = "branches.cfg";
+static char g_loanFile[PATH_LEN] = "interbranch.dat";
+static char g_dataFile[PATH_LEN] = "books.dat";
+static char g_studentFile[PATH_LEN] = "students.dat";
+static char g_issueFile[PATH_LEN] = "issues.dat";
+static char g_bookIndex[PATH_LEN] = "books.idx";
+static char g_studentIndex[PATH_LEN] = "students.idx";
+#define DATA_FILE     g_dataFile
+#define STUDENT_FILE  g_studentFile
+#define ISSUE_FILE    g_issueFile
+#define BRANCH_CFG    g_branchCfg
+#define LOAN_FILE     g_loanFile
 
 // Models
 struct Book {
@@ -51,8 +105,322 @@ struct Issue {
     int due_days;
     int returned;     
     time_t return_time;
+    time_t due_time;      // issue_time + due_days
+    int issue_day;        // local calendar days since 1970-01-01, see localDayOf()
+    int due_day;
+    int return_day;
+    int reserved;
+};
+
+// A loan of a book owned by `lending` to a student registered at `home`.
+struct BranchLoan {
+    char lending[BRANCH_CODE_LEN];
+    char home[BRANCH_CODE_LEN];
+    struct Issue iss;
+};
+
+// Record layouts before DATA_FORMAT 2, kept for migrateDataFormat().
+struct IssueV1 {
+    int book_id;
+    int student_id;
+    time_t issue_time;
+    int due_days;
+    int returned;
+    time_t return_time;
+};
+
+struct BranchLoanV1 {
+    int book_id;
+    int student_id;
+    char lending[BRANCH_CODE_LEN];
+    char home[BRANCH_CODE_LEN];
+    time_t issue_time;
+    int due_days;
+    int returned;
+    time_t return_time;
+};
+
+// Replication log: every committed write to the data files is appended to
+// changes.log as either "write these bytes at this offset" or "replace the
+// whole file". A follower replays records in order into REPLICA_DIR; both
+// kinds are idempotent, so replaying a record twice is harmless. Each new
+// log gets a fresh epoch so a follower notices when it has been recreated.
+enum { LOG_WRITE_AT = 1, LOG_REPLACE = 2 };
+
+struct LogHeader {
+    unsigned magic;
+    unsigned version;
+    unsigned long long epoch;
+    unsigned long long lastSeq;
+    long long lastTime;
+    long long base;        // logical offset of the first record in the file
+    long long snapEnd;     // logical end of this epoch's base copy
+    long long endOffset;   // logical; file position is offset - base + sizeof header
+};
+
+struct LogRecord {
+    unsigned magic;
+    unsigned op;
+    unsigned long long seq;
+    long long time;
+    long long offset;
+    unsigned pathLen;
+    unsigned checksum;   // over path and data
+    unsigned long long dataLen;
+};
+
+struct ReplicaState {
+    unsigned magic;
+    unsigned reserved;
+    unsigned long long epoch;      // of the log appliedSeq/appliedOffset refer to
+    unsigned long long appliedSeq;
+    long long appliedOffset;
+    long long appliedTime;
+};
+
+
+// ID indexes: sorted (id, record number) pairs over books.dat / students.dat,
+// snapshotted to disk so startup does not have to rescan the data files.
+struct IndexEntry {
+    int id;
+    int rec;
 };
 
+struct IndexHeader {
+    unsigned magic;
+    unsigned version;
+    unsigned recSize;
+    unsigned checksum;   // over the entries
+    unsigned tailSum;    // over the IDs of the last indexed data records
+    unsigned reserved;
+    long long dataSize;
+    long long dataMtime;
+    long long count;
+};
+
+struct IdIndex {
+    const char *dataFile;
+    const char *indexFile;
+    size_t recSize;
+    struct IndexEntry *ent;
+    size_t count, cap;
+    int ready;
+    long long dataSize, dataMtime;   // data file as last indexed
+};
+
+static struct IdIndex bookIndex = { DATA_FILE, BOOK_INDEX, sizeof(struct Book), NULL, 0, 0, 0, 0, 0 };
+static struct IdIndex studentIndex = { STUDENT_FILE, STUDENT_INDEX, sizeof(struct Student), NULL, 0, 0, 0, 0, 0 };
+
+static unsigned fnv1a(const void *data, size_t len, unsigned h) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+static int fileStat(const char *path, long long *size, long long *mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    *size = (long long)st.st_size;
+    *mtime = (long long)st.st_mtime;
+    return 1;
+}
+
+static int cmpIndexEntry(const void *a, const void *b) {
+    int x = ((const struct IndexEntry *)a)->id, y = ((const struct IndexEntry *)b)->id;
+    return (x > y) - (x < y);
+}
+
+static int indexReserve(struct IdIndex *idx, size_t n) {
+    if (n <= idx->cap) return 1;
+    size_t cap = idx->cap ? idx->cap : 256;
+    while (cap < n) cap *= 2;
+    struct IndexEntry *p = realloc(idx->ent, cap * sizeof(*p));
+    if (!p) return 0;
+    idx->ent = p; idx->cap = cap;
+    return 1;
+}
+
+// Indexes data records from `fromRec` onwards (0 for a full rebuild).
+static int indexScan(struct IdIndex *idx, long fromRec) {
+    idx->ready = 0;
+    idx->count = (size_t)fromRec;
+    FILE *f = fopen(idx->dataFile, "rb");
+    if (!f) return 0;
+    if (fseek(f, fromRec * (long)idx->recSize, SEEK_SET) != 0) { fclose(f); return 0; }
+    char buf[sizeof(struct Book) > sizeof(struct Student) ? sizeof(struct Book) : sizeof(struct Student)];
+    long rec = fromRec;
+    while (fread(buf, idx->recSize, 1, f)) {
+        if (!indexReserve(idx, idx->count + 1)) { fclose(f); return 0; }
+        memcpy(&idx->ent[idx->count].id, buf, sizeof(int));
+        idx->ent[idx->count].rec = (int)rec++;
+        idx->count++;
+    }
+    fclose(f);
+    qsort(idx->ent, idx->count, sizeof(*idx->ent), cmpIndexEntry);
+    idx->ready = 1;
+    if (!fileStat(idx->dataFile, &idx->dataSize, &idx->dataMtime)) idx->dataSize = idx->dataMtime = -1;
+    return 1;
+}
+
+static int indexRebuild(struct IdIndex *idx) {
+    return indexScan(idx, 0);
+}
+
+// Fingerprint of the IDs of the last INDEX_TAIL_RECS records. In-place
+// writes (issue, return, edits) never change IDs and leave it alone; a
+// rewritten file, or a delete followed by an add, changes it.
+static unsigned dataTailSum(const struct IdIndex *idx, long long count) {
+    if (count <= 0) return 0;
+    FILE *f = fopen(idx->dataFile, "rb");
+    if (!f) return 0;
+    char buf[sizeof(struct Book) > sizeof(struct Student) ? sizeof(struct Book) : sizeof(struct Student)];
+    long long rec = count > INDEX_TAIL_RECS ? count - INDEX_TAIL_RECS : 0;
+    unsigned h = 2166136261u;
+    int ok = fseek(f, (long)(rec * (long long)idx->recSize), SEEK_SET) == 0;
+    for (; ok && rec < count; rec++) {
+        if ((ok = fread(buf, idx->recSize, 1, f) == 1)) h = fnv1a(buf, sizeof(int), h);
+    }
+    fclose(f);
+    return ok ? h : 0;
+}
+
+// Loads a snapshot if it still describes the data file. A snapshot taken
+// before records were appended is caught up by indexing only the new tail;
+// one whose file was only rewritten in place (newer mtime, same IDs at the
+// tail) is used as is, since indexFetch checks the ID of every record read.
+static int indexLoadSnapshot(struct IdIndex *idx) {
+    long long size, mtime;
+    if (!fileStat(idx->dataFile, &size, &mtime)) return 0;
+    FILE *f = fopen(idx->indexFile, "rb");
+    if (!f) return 0;
+    struct IndexHeader h;
+    if (!fread(&h, sizeof(h), 1, f) || h.magic != INDEX_MAGIC || h.version != INDEX_VERSION
+        || h.recSize != idx->recSize || h.count < 0 || h.dataSize != h.count * (long long)idx->recSize
+        || h.dataSize > size) {
+        fclose(f); return 0;
+    }
+    if (!indexReserve(idx, (size_t)h.count)
+        || fread(idx->ent, sizeof(*idx->ent), (size_t)h.count, f) != (size_t)h.count
+        || fnv1a(idx->ent, (size_t)h.count * sizeof(*idx->ent), 2166136261u) != h.checksum) {
+        fclose(f); return 0;
+    }
+    fclose(f);
+    if (dataTailSum(idx, h.count) != h.tailSum) return 0;
+    idx->count = (size_t)h.count;
+    idx->ready = 1;
+    idx->dataSize = size;
+    idx->dataMtime = mtime;
+    if (size > h.dataSize) return indexScan(idx, (long)h.count);
+    return 1;
+}
+
+static int indexSaveSnapshot(const struct IdIndex *idx) {
+    if (!idx->ready) return 0;
+    struct IndexHeader h;
+    memset(&h, 0, sizeof(h));
+    if (!fileStat(idx->dataFile, &h.dataSize, &h.dataMtime)) return 0;
+    if (h.dataSize != (long long)idx->count * (long long)idx->recSize) return 0;
+    h.magic = INDEX_MAGIC;
+    h.version = INDEX_VERSION;
+    h.recSize = (unsigned)idx->recSize;
+    h.count = (long long)idx->count;
+    h.checksum = fnv1a(idx->ent, idx->count * sizeof(*idx->ent), 2166136261u);
+    h.tailSum = dataTailSum(idx, h.count);
+    char tmp[128];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", idx->indexFile);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return 0;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1
+          && fwrite(idx->ent, sizeof(*idx->ent), idx->count, f) == idx->count;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+    remove(idx->indexFile); rename(tmp, idx->indexFile);
+    return 1;
+}
+
+static void indexOpen(struct IdIndex *idx) {
+    if (!indexLoadSnapshot(idx)) indexRebuild(idx);
+}
+
+static long indexFind(const struct IdIndex *idx, int id) {
+    size_t lo = 0, hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->ent[mid].id < id) lo = mid + 1; else hi = mid;
+    }
+    return (lo < idx->count && idx->ent[lo].id == id) ? idx->ent[lo].rec : -1;
+}
+
+// Records our own append of `id` at `rec`. The data file is only marked as
+// indexed when it grew by exactly that record; if another desk appended as
+// well, the stale size makes the next lookup pick its records up.
+static void indexAdd(struct IdIndex *idx, int id, long rec) {
+    if (!idx->ready) return;
+    if (!indexReserve(idx, idx->count + 1)) { idx->ready = 0; return; }
+    long long oldSize = idx->dataSize, size, mtime;
+    int inSync = oldSize == (long long)idx->count * (long long)idx->recSize;
+    size_t lo = 0, hi = idx->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (idx->ent[mid].id < id) lo = mid + 1; else hi = mid;
+    }
+    memmove(&idx->ent[lo + 1], &idx->ent[lo], (idx->count - lo) * sizeof(*idx->ent));
+    idx->ent[lo].id = id;
+    idx->ent[lo].rec = (int)rec;
+    idx->count++;
+    if (inSync && fileStat(idx->dataFile, &size, &mtime) && size == oldSize + (long long)idx->recSize) {
+        idx->dataSize = size;
+        idx->dataMtime = mtime;
+    }
+}
+
+// Brings the index up to date if another process changed the data file
+// since it was built: appended records are indexed, anything else rebuilds.
+// Returns 1 if the index changed.
+static int indexRefresh(struct IdIndex *idx) {
+    long long size, mtime;
+    if (!fileStat(idx->dataFile, &size, &mtime)) return 0;
+    if (size == idx->dataSize && mtime == idx->dataMtime) return 0;
+    if (size > idx->dataSize && idx->dataSize == (long long)idx->count * (long long)idx->recSize)
+        indexScan(idx, (long)idx->count);
+    else
+        indexRebuild(idx);
+    return 1;
+}
+
+// Reads the record for `id` through the index. Returns -1 when the index
+// is unusable so the caller can fall back to a linear scan.
+static int indexFetch(struct IdIndex *idx, int id, void *out) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!idx->ready) return -1;
+        long rec = indexFind(idx, id);
+        if (rec < 0) {
+            if (!indexRefresh(idx)) return 0;
+            if (!idx->ready) return -1;
+            if ((rec = indexFind(idx, id)) < 0) return 0;
+        }
+        FILE *f = fopen(idx->dataFile, "rb");
+        if (!f) return 0;
+        int ok = fseek(f, rec * (long)idx->recSize, SEEK_SET) == 0 && fread(out, idx->recSize, 1, f) == 1;
+        fclose(f);
+        int got = 0;
+        if (ok) memcpy(&got, out, sizeof(got));
+        if (ok && got == id) return 1;
+        indexRebuild(idx);  // data file changed underneath us
+    }
+    return -1;
+}
+
+static void indexesOpen(void) {
+    indexOpen(&bookIndex);
+    indexOpen(&studentIndex);
+}
+
+static void indexesCheckpoint(void) {
+    indexSaveSnapshot(&bookIndex);
+    indexSaveSnapshot(&studentIndex);
+}
+
 
 static void pauseForUser(void) {
     printf("\nPress Enter to continue...");
@@ -61,10 +429,146 @@ static void pauseForUser(void) {
 }
 
 
+typedef void (*TaskFn)(void *arg);
+
+struct Task {
+    TaskFn fn;
+    void *arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI taskEntry(LPVOID p) { struct Task *t = p; t->fn(t->arg); return 0; }
+#else
+static void *taskEntry(void *p) { struct Task *t = p; t->fn(t->arg); return NULL; }
+#endif
+
+// Runs fn on each of the n argument slots (argSize bytes apart) in its own
+// thread and waits for all of them. Falls back to running inline.
+static void runParallel(TaskFn fn, void *args, size_t argSize, int n) {
+    struct Task tasks[MAX_BRANCHES];
+#ifdef _WIN32
+    HANDLE th[MAX_BRANCHES];
+#else
+    pthread_t th[MAX_BRANCHES];
+#endif
+    int started[MAX_BRANCHES];
+    if (n > MAX_BRANCHES) n = MAX_BRANCHES;
+    for (int i = 0; i < n; i++) {
+        tasks[i].fn = fn;
+        tasks[i].arg = (char *)args + (size_t)i * argSize;
+#ifdef _WIN32
+        th[i] = CreateThread(NULL, 0, taskEntry, &tasks[i], 0, NULL);
+        started[i] = th[i] != NULL;
+#else
+        started[i] = pthread_create(&th[i], NULL, taskEntry, &tasks[i]) == 0;
+#endif
+        if (!started[i]) fn(tasks[i].arg);
+    }
+    for (int i = 0; i < n; i++) {
+        if (!started[i]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+#else
+        pthread_join(th[i], NULL);
+#endif
+    }
+}
+
+// Dates: issue records carry their due time and local epoch days, worked
+// out once when the record is written. Reports turn day numbers into text
+// through a small memo table and make no libc time calls per row.
 static void safeLocalTime(struct tm *out, const time_t *t) {
-    struct tm *tmp = localtime(t);
-    if (tmp) *out = *tmp;
-    else memset(out, 0, sizeof(*out));
+#ifdef _WIN32
+    if (localtime_s(out, t) != 0) memset(out, 0, sizeof(*out));
+#else
+    if (!localtime_r(t, out)) memset(out, 0, sizeof(*out));
+#endif
+}
+
+static int daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(int z, int *y, int *m, int *d) {
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+static int localDayOf(time_t t) {
+    struct tm tm1;
+    safeLocalTime(&tm1, &t);
+    return daysFromCivil(tm1.tm_year + 1900, tm1.tm_mon + 1, tm1.tm_mday);
+}
+
+#define DATE_CACHE_SLOTS 512
+#define DATE_MIN_DAY (-719528)   // 0000-01-01
+#define DATE_MAX_DAY 2932896     // 9999-12-31
+
+struct DateSlot {
+    int day;
+    int used;
+    char text[16];
+};
+
+static struct DateSlot g_dateCache[DATE_CACHE_SLOTS];
+
+// Writes the day as YYYY-MM-DD into out (16 bytes). Main thread only.
+// Days outside years 0000-9999 (corrupt records) are clamped to that range.
+static void formatDay(int day, char *out) {
+    struct DateSlot *slot = &g_dateCache[(unsigned)day % DATE_CACHE_SLOTS];
+    if (!slot->used || slot->day != day) {
+        int y, m, d;
+        civilFromDays(day < DATE_MIN_DAY ? DATE_MIN_DAY : day > DATE_MAX_DAY ? DATE_MAX_DAY : day, &y, &m, &d);
+        snprintf(slot->text, sizeof(slot->text), "%04u-%02u-%02u", (unsigned)y % 10000u, (unsigned)m % 100u, (unsigned)d % 100u);
+        slot->day = day;
+        slot->used = 1;
+    }
+    memcpy(out, slot->text, sizeof(slot->text));
+}
+
+static void formatReturnDay(const struct Issue *iss, char *out) {
+    if (iss->returned) formatDay(iss->return_day, out);
+    else strcpy(out, "-");
+}
+
+static void issueInit(struct Issue *iss, int book_id, int student_id, time_t issued, int due_days) {
+    memset(iss, 0, sizeof(*iss));
+    iss->book_id = book_id;
+    iss->student_id = student_id;
+    iss->issue_time = issued;
+    iss->due_days = due_days;
+    iss->due_time = issued + (time_t)due_days * 24 * 3600;
+    iss->issue_day = localDayOf(issued);
+    iss->due_day = localDayOf(iss->due_time);
+}
+
+static void issueMarkReturned(struct Issue *iss, time_t at) {
+    iss->returned = 1;
+    iss->return_time = at;
+    iss->return_day = localDayOf(at);
+}
+
+// Whole days late at `at`, rounding part days up; 0 when not late.
+static long lateDays(time_t due, time_t at) {
+    long long secondsLate = (long long)at - (long long)due;
+    return secondsLate > 0 ? (long)((secondsLate + 24*3600 - 1) / (24*3600)) : 0;
+}
+
+static long fineFor(long daysLate) {
+    return daysLate * FINE_PER_DAY;
 }
 
 
@@ -100,12 +604,311 @@ static void readPasswordMasked(char *out, size_t sz) {
         else if (ch >= 32 && ch <= 126) { if (i + 1 < sz) { out[i++] = (char)ch; printf("*"); } }
     }
 }
+// Returns 0 (and an empty path, so opens fail) if the path does not fit.
+static int branchPath(char *out, size_t sz, const char *branch, const char *name) {
+    const char *sep = g_root[0] ? "/" : "";
+    int n;
+    if (strcmp(branch, MAIN_BRANCH) == 0) n = snprintf(out, sz, "%s%s%s", g_root, sep, name);
+    else n = snprintf(out, sz, "%s%s%s/%s/%s", g_root, sep, BRANCH_DIR, branch, name);
+    if (n < 0 || (size_t)n >= sz) { out[0] = 0; return 0; }
+    return 1;
+}
+
+static void setBranchPaths(const char *code) {
+    snprintf(g_branch, sizeof(g_branch), "%s", code);
+    branchPath(g_dataFile, PATH_LEN, code, "books.dat");
+    branchPath(g_studentFile, PATH_LEN, code, "students.dat");
+    branchPath(g_issueFile, PATH_LEN, code, "issues.dat");
+    branchPath(g_bookIndex, PATH_LEN, code, "books.idx");
+    branchPath(g_studentIndex, PATH_LEN, code, "students.idx");
+}
+
+// Advisory locks serialising check-then-write sequences between desk
+// processes. Each branch has its own lock so branches never contend; the
+// shared loan ledger has one too. Take the ledger lock before a branch lock.
+struct FileLock {
+#ifdef _WIN32
+    HANDLE h;
+#else
+    int fd;
+#endif
+};
+
+static int lockAcquire(struct FileLock *lk, const char *path) {
+#ifdef _WIN32
+    lk->h = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (lk->h == INVALID_HANDLE_VALUE) return 0;
+    OVERLAPPED ov; memset(&ov, 0, sizeof(ov));
+    if (!LockFileEx(lk->h, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov)) { CloseHandle(lk->h); return 0; }
+#else
+    lk->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (lk->fd < 0) return 0;
+    while (flock(lk->fd, LOCK_EX) != 0) {
+        if (errno != EINTR) { close(lk->fd); return 0; }
+    }
+#endif
+    return 1;
+}
+
+static void lockRelease(struct FileLock *lk) {
+#ifdef _WIN32
+    OVERLAPPED ov; memset(&ov, 0, sizeof(ov));
+    UnlockFileEx(lk->h, 0, 1, 0, &ov);
+    CloseHandle(lk->h);
+#else
+    flock(lk->fd, LOCK_UN);
+    close(lk->fd);
+#endif
+}
+
+static int lockBranch(struct FileLock *lk, const char *branch) {
+    char path[PATH_LEN]; branchPath(path, sizeof(path), branch, "branch.lock");
+    if (lockAcquire(lk, path)) return 1;
+    printf("Unable to lock branch %s.\n", branch);
+    return 0;
+}
+
+static int lockLedger(struct FileLock *lk) {
+    char path[PATH_LEN]; branchPath(path, sizeof(path), MAIN_BRANCH, "interbranch.lock");
+    if (lockAcquire(lk, path)) return 1;
+    printf("Unable to lock the inter-branch ledger.\n");
+    return 0;
+}
+
+static void setDataRoot(const char *root) {
+    snprintf(g_root, sizeof(g_root), "%s", root);
+    branchPath(g_branchCfg, PATH_LEN, MAIN_BRANCH, "branches.cfg");
+    branchPath(g_loanFile, PATH_LEN, MAIN_BRANCH, "interbranch.dat");
+    char code[BRANCH_CODE_LEN];
+    memcpy(code, g_branch, sizeof(code));
+    setBranchPaths(code);
+}
+
 static void ensureDataFilesExist(void) {
     FILE *f;
+    if (strcmp(g_branch, MAIN_BRANCH) != 0) {
+        char dir[PATH_LEN];
+        snprintf(dir, sizeof(dir), "%s/%s", BRANCH_DIR, g_branch);
+        makeDir(BRANCH_DIR);
+        makeDir(dir);
+    }
     f = fopen(DATA_FILE, "ab"); if (f) fclose(f);
     f = fopen(STUDENT_FILE, "ab"); if (f) fclose(f);
     f = fopen(ISSUE_FILE, "ab"); if (f) fclose(f);
 }
+
+// Reads a record header and its path; the data follows at the current
+// position. Returns 0 at end of log or on a torn/corrupt record.
+static int readLogHead(FILE *f, struct LogRecord *r, char *path, size_t pathSz) {
+    if (!fread(r, sizeof(*r), 1, f) || r->magic != REPL_MAGIC || r->pathLen == 0 || r->pathLen >= pathSz) return 0;
+    if (fread(path, 1, r->pathLen, f) != r->pathLen) return 0;
+    path[r->pathLen] = 0;
+    return 1;
+}
+
+// Reads the data of r in chunks, copying it to `out` or `mem` when given,
+// and checks it against r->checksum. Returns 0 on a torn/corrupt record.
+static int readLogData(FILE *f, const struct LogRecord *r, const char *path, FILE *out, unsigned char *mem) {
+    unsigned sum = fnv1a(path, r->pathLen, 2166136261u);
+    unsigned char buf[4096];
+    for (unsigned long long left = r->dataLen; left > 0; ) {
+        size_t n = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+        if (fread(buf, 1, n, f) != n) return 0;
+        if (out && fwrite(buf, 1, n, out) != n) return 0;
+        if (mem) { memcpy(mem, buf, n); mem += n; }
+        sum = fnv1a(buf, n, sum);
+        left -= n;
+    }
+    return sum == r->checksum;
+}
+
+// Replication is on while changes.log exists. Checked on every write so a
+// desk process that started before the log was created still feeds it.
+static int journalActive(void) {
+    struct stat st;
+    return stat(REPL_LOG, &st) == 0;
+}
+
+static int readLogHeader(FILE *f, struct LogHeader *h) {
+    return fseek(f, 0, SEEK_SET) == 0 && fread(h, sizeof(*h), 1, f) == 1 && h->magic == REPL_MAGIC
+        && h->version == REPL_VERSION && h->base >= (long long)sizeof(*h) && h->endOffset >= h->base;
+}
+
+// Log offsets are logical: trimming drops records from the front of the
+// file and raises base, so offsets the follower holds stay valid.
+static long long logPos(const struct LogHeader *h, long long offset) {
+    return offset - h->base + (long long)sizeof(*h);
+}
+
+static long long logOffset(const struct LogHeader *h, long long pos) {
+    return pos + h->base - (long long)sizeof(*h);
+}
+
+// Locks the log and reads its header. Several desk processes may append to
+// the same log, so the end offset is never cached between appends; records
+// a crashed writer got out before its header update are picked up here too.
+static FILE *journalBegin(struct FileLock *lk, struct LogHeader *h) {
+    if (!journalActive() || !lockAcquire(lk, REPL_LOCK)) return NULL;
+    FILE *f = fopen(REPL_LOG, "rb+");
+    if (f && readLogHeader(f, h) && fseek64(f, logPos(h, h->endOffset), SEEK_SET) == 0) {
+        struct LogRecord r; char path[PATH_LEN];
+        while (readLogHead(f, &r, path, sizeof(path)) && readLogData(f, &r, path, NULL, NULL)) {
+            h->lastSeq = r.seq;
+            h->lastTime = r.time;
+            h->endOffset = logOffset(h, ftell64(f));
+        }
+        return f;
+    }
+    if (f) fclose(f);
+    lockRelease(lk);
+    return NULL;
+}
+
+// Snapshot of the header for status output; takes no lock.
+static int journalReadHeader(struct LogHeader *h) {
+    FILE *f = fopen(REPL_LOG, "rb");
+    if (!f) return 0;
+    int ok = readLogHeader(f, h);
+    fclose(f);
+    return ok;
+}
+
+static void journalEnd(FILE *f, const struct LogHeader *h, struct FileLock *lk) {
+    if (f) {
+        fseek(f, 0, SEEK_SET);
+        fwrite(h, sizeof(*h), 1, f);
+        fclose(f);
+    }
+    lockRelease(lk);
+}
+
+static void journalOpen(void) {
+    if (!journalActive()) return;
+    struct FileLock lk; struct LogHeader h;
+    FILE *f = journalBegin(&lk, &h);
+    if (!f) { printf("Replication log %s is unreadable; restart it from the admin menu.\n", REPL_LOG); return; }
+    journalEnd(f, &h, &lk);
+}
+
+static int replicaLoadState(struct ReplicaState *st) {
+    memset(st, 0, sizeof(*st));
+    FILE *f = fopen(REPLICA_STATE, "rb");
+    if (f) {
+        if (!fread(st, sizeof(*st), 1, f) || st->magic != REPL_MAGIC) memset(st, 0, sizeof(*st));
+        fclose(f);
+    }
+    if (st->appliedOffset < (long long)sizeof(struct LogHeader)) st->appliedOffset = (long long)sizeof(struct LogHeader);
+    st->magic = REPL_MAGIC;
+    return 1;
+}
+
+// Drops the records the follower has applied by rewriting the log from its
+// applied offset. Unless `always`, only when that frees half the log. Runs
+// with the log locked and returns the reopened log. On Windows the rename
+// fails while the follower has the log open; the next trim retries.
+static FILE *journalTrim(FILE *f, struct LogHeader *h, int always) {
+    struct ReplicaState st;
+    replicaLoadState(&st);
+    long long keep = st.appliedOffset;
+    if (st.epoch != h->epoch || keep <= h->base || keep > h->endOffset) return f;
+    if (!always && keep - h->base < (h->endOffset - h->base) / 2) return f;
+    FILE *out = fopen(REPL_LOG ".tmp", "wb");
+    if (!out) return f;
+    struct LogHeader nh = *h;
+    nh.base = keep;
+    int ok = fwrite(&nh, sizeof(nh), 1, out) == 1 && fseek64(f, logPos(h, keep), SEEK_SET) == 0;
+    unsigned char buf[4096];
+    for (long long left = h->endOffset - keep; ok && left > 0; ) {
+        size_t n = left < (long long)sizeof(buf) ? (size_t)left : sizeof(buf);
+        ok = fread(buf, 1, n, f) == n && fwrite(buf, 1, n, out) == n;
+        left -= (long long)n;
+    }
+    if (fclose(out) != 0) ok = 0;
+    if (ok) {
+        fclose(f);
+        remove(REPL_LOG);
+        ok = rename(REPL_LOG ".tmp", REPL_LOG) == 0;
+        f = fopen(REPL_LOG, "rb+");
+    }
+    if (ok) *h = nh;
+    else remove(REPL_LOG ".tmp");
+    return f;
+}
+
+// Appends one record at the end of the log. Whole-file records stream their
+// data from `src` so the file is never held in memory. The record header is
+// written last, so a torn append never looks like a complete record.
+static void journalAppend(unsigned op, const char *path, long long offset, const void *data, size_t len, FILE *src) {
+    struct FileLock lk; struct LogHeader h;
+    FILE *f = journalBegin(&lk, &h);
+    if (!f) {
+        if (journalActive()) printf("Warning: unable to append to replication log.\n");
+        return;
+    }
+    struct LogRecord r;
+    memset(&r, 0, sizeof(r));
+    r.magic = REPL_MAGIC;
+    r.op = op;
+    r.seq = h.lastSeq + 1;
+    r.time = (long long)time(NULL);
+    r.offset = offset;
+    r.pathLen = (unsigned)strlen(path);
+    r.checksum = fnv1a(path, r.pathLen, 2166136261u);
+    long long at = logPos(&h, h.endOffset);
+    int ok = fseek64(f, at + (long long)sizeof(r), SEEK_SET) == 0 && fwrite(path, 1, r.pathLen, f) == r.pathLen;
+    if (src) {
+        unsigned char buf[4096]; size_t n;
+        while (ok && (n = fread(buf, 1, sizeof(buf), src)) > 0) {
+            ok = fwrite(buf, 1, n, f) == n;
+            r.checksum = fnv1a(buf, n, r.checksum);
+            r.dataLen += n;
+        }
+        if (ferror(src)) ok = 0;
+    } else if (ok) {
+        ok = fwrite(data, 1, len, f) == len;
+        r.checksum = fnv1a(data, len, r.checksum);
+        r.dataLen = len;
+    }
+    long long end = ok ? ftell64(f) : -1;
+    if (!ok || end < 0 || fflush(f) != 0 || fseek64(f, at, SEEK_SET) != 0
+        || fwrite(&r, sizeof(r), 1, f) != 1 || fflush(f) != 0) {
+        printf("Warning: unable to append to replication log.\n");
+        fclose(f); lockRelease(&lk);
+        return;
+    }
+    h.lastSeq = r.seq;
+    h.lastTime = r.time;
+    h.endOffset = logOffset(&h, end);
+    if (h.endOffset - h.base > REPL_MAX_BYTES) f = journalTrim(f, &h, 0);
+    journalEnd(f, &h, &lk);
+}
+
+// Drops what the follower has applied.
+static void journalCompact(void) {
+    struct FileLock lk; struct LogHeader h;
+    FILE *f = journalBegin(&lk, &h);
+    if (!f) return;
+    f = journalTrim(f, &h, 1);
+    journalEnd(f, &h, &lk);
+}
+
+static void journalReplace(const char *path) {
+    if (!journalActive()) return;
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    journalAppend(LOG_REPLACE, path, 0, NULL, 0, f);
+    fclose(f);
+}
+
+// fwrite of one record that is also shipped to the replication log. The
+// record is flushed to the data file first, so the log never holds a change
+// the data file does not.
+static size_t loggedWrite(FILE *f, const char *path, const void *rec, size_t len) {
+    if (fwrite(rec, len, 1, f) != 1 || fflush(f) != 0) return 0;
+    if (journalActive()) journalAppend(LOG_WRITE_AT, path, ftell64(f) - (long long)len, rec, len, NULL);
+    return 1;
+}
 static int adminPasswordRead(char *buf, int size) {
     FILE *f = fopen(ADMIN_CFG, "r");
     if (!f) {
@@ -160,9 +963,14 @@ static void resetAdminPasswordToDefault(void) {
     printf("Admin password reset to default '%s'.\n", DEFAULT_ADMIN_PASS);
 }
 static int studentExists(int id, char *nameBuf) {
+    struct Student s;
+    int r = indexFetch(&studentIndex, id, &s);
+    if (r >= 0) {
+        if (r && nameBuf) snprintf(nameBuf, sizeof(s.name), "%s", s.name);
+        return r;
+    }
     FILE *f = fopen(STUDENT_FILE, "rb");
     if (!f) return 0;
-    struct Student s;
     while (fread(&s, sizeof(s), 1, f)) {
         if (s.id == id) {
             if (nameBuf) strncpy(nameBuf, s.name, 99);
@@ -177,8 +985,8 @@ static int studentExists(int id, char *nameBuf) {
 static int studentIdDuplicate(int id) {
     return studentExists(id, NULL);
 }
-static int bookExists(int id, struct Book *out) {
-    FILE *f = fopen(DATA_FILE, "rb");
+static int findBookIn(const char *path, int id, struct Book *out) {
+    FILE *f = fopen(path, "rb");
     if (!f) return 0;
     struct Book b;
     while (fread(&b, sizeof(b), 1, f)) {
@@ -192,6 +1000,63 @@ static int bookExists(int id, struct Book *out) {
     return 0;
 }
 
+static int bookExists(int id, struct Book *out) {
+    struct Book b;
+    int r = indexFetch(&bookIndex, id, &b);
+    if (r >= 0) {
+        if (r && out) *out = b;
+        return r;
+    }
+    return findBookIn(DATA_FILE, id, out);
+}
+
+static int setBookAvailable(const char *path, int id, int available) {
+    FILE *fb = fopen(path, "rb+");
+    if (!fb) return 0;
+    struct Book b; int found = 0;
+    while (fread(&b, sizeof(b), 1, fb)) {
+        if (b.id == id) {
+            b.available = available;
+            fseek(fb, - (long)sizeof(b), SEEK_CUR);
+            loggedWrite(fb, path, &b, sizeof(b));
+            found = 1; break;
+        }
+    }
+    fclose(fb);
+    return found;
+}
+
+// Next ledger row whose home branch (byHome) or lending branch is the
+// current one; fl may be NULL when there is no ledger yet.
+static int nextBranchLoan(FILE *fl, int byHome, struct BranchLoan *ln) {
+    while (fl && fread(ln, sizeof(*ln), 1, fl)) {
+        if (strcmp(byHome ? ln->home : ln->lending, g_branch) == 0) return 1;
+    }
+    return 0;
+}
+
+static int branchLoanOpen(const char *lending, int book_id) {
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    if (!fl) return 0;
+    struct BranchLoan ln;
+    while (fread(&ln, sizeof(ln), 1, fl)) {
+        if (ln.iss.book_id == book_id && !ln.iss.returned && strcmp(ln.lending, lending) == 0) { fclose(fl); return 1; }
+    }
+    fclose(fl);
+    return 0;
+}
+
+static int studentLoanOpen(const char *home, int student_id) {
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    if (!fl) return 0;
+    struct BranchLoan ln;
+    while (fread(&ln, sizeof(ln), 1, fl)) {
+        if (ln.iss.student_id == student_id && !ln.iss.returned && strcmp(ln.home, home) == 0) { fclose(fl); return 1; }
+    }
+    fclose(fl);
+    return 0;
+}
+
 static int bookIdDuplicate(int id) {
     return bookExists(id, NULL);
 }
@@ -207,13 +1072,13 @@ static int bookIsIssued(int book_id) {
 }
 static int studentHasUnreturned(int student_id) {
     FILE *fi = fopen(ISSUE_FILE, "rb");
-    if (!fi) return 0;
+    if (!fi) return studentLoanOpen(g_branch, student_id);
     struct Issue iss;
     while (fread(&iss, sizeof(iss), 1, fi)) {
         if (iss.student_id == student_id && !iss.returned) { fclose(fi); return 1; }
     }
     fclose(fi);
-    return 0;
+    return studentLoanOpen(g_branch, student_id);
 }
 static void addBook(void) {
     printf("Enter Book ID: ");
@@ -227,48 +1092,72 @@ static void addBook(void) {
     printf("Enter Title: "); readLineSafe(b.title, sizeof(b.title));
     printf("Enter Author: "); readLineSafe(b.author, sizeof(b.author));
     b.available = 1;
+    // Check again under the lock: another desk may have added the ID meanwhile.
+    struct FileLock branch;
+    if (!lockBranch(&branch, g_branch)) return;
+    if (bookIdDuplicate(id)) { lockRelease(&branch); printf("Book ID already exists.\n"); return; }
     FILE *f = fopen(DATA_FILE, "ab");
-    if (!f) { printf("Unable to open books file.\n"); return; }
-    fwrite(&b, sizeof(b), 1, f);
+    if (!f) { lockRelease(&branch); printf("Unable to open books file.\n"); return; }
+    loggedWrite(f, DATA_FILE, &b, sizeof(b));
+    long rec = ftell(f) / (long)sizeof(b) - 1;
     fclose(f);
+    indexAdd(&bookIndex, b.id, rec);
+    lockRelease(&branch);
     printf("Book added.\n");
 }
 static void updateBook(void) {
     printf("Enter Book ID to update: ");
     int id;
     if (!readInt(&id)) { printf("Invalid input.\n"); return; }
+    if (!bookExists(id, NULL)) { printf("Book not found.\n"); return; }
+    struct Book upd;
+    getchar();
+    printf("Enter new Title: "); readLineSafe(upd.title, sizeof(upd.title));
+    printf("Enter new Author: "); readLineSafe(upd.author, sizeof(upd.author));
+    // Re-read under the lock so a concurrent issue/return keeps its availability.
+    struct FileLock branch;
+    if (!lockBranch(&branch, g_branch)) return;
     FILE *f = fopen(DATA_FILE, "rb+");
-    if (!f) { printf("No books.\n"); return; }
+    if (!f) { lockRelease(&branch); printf("No books.\n"); return; }
     struct Book b; int found = 0;
     while (fread(&b, sizeof(b), 1, f)) {
         if (b.id == id) {
-            getchar();
-            printf("Enter new Title: "); readLineSafe(b.title, sizeof(b.title));
-            printf("Enter new Author: "); readLineSafe(b.author, sizeof(b.author));
+            memcpy(b.title, upd.title, sizeof(b.title));
+            memcpy(b.author, upd.author, sizeof(b.author));
             fseek(f, - (long)sizeof(b), SEEK_CUR);
-            fwrite(&b, sizeof(b), 1, f);
-            printf("Book updated.\n");
+            loggedWrite(f, DATA_FILE, &b, sizeof(b));
             found = 1; break;
         }
     }
     fclose(f);
-    if (!found) printf("Book not found.\n");
+    lockRelease(&branch);
+    printf(found ? "Book updated.\n" : "Book not found.\n");
 }
 static void deleteBook(void) {
     printf("Enter Book ID to delete: ");
     int id; if (!readInt(&id)) { printf("Invalid input.\n"); return; }
-    if (bookIsIssued(id)) { printf("Book currently issued - cannot delete.\n"); return; }
+    struct FileLock ledger, branch;
+    if (!lockLedger(&ledger)) return;
+    if (!lockBranch(&branch, g_branch)) { lockRelease(&ledger); return; }
+    if (bookIsIssued(id) || branchLoanOpen(g_branch, id)) {
+        lockRelease(&branch); lockRelease(&ledger);
+        printf("Book currently issued - cannot delete.\n"); return;
+    }
     FILE *src = fopen(DATA_FILE, "rb");
-    if (!src) { printf("No books.\n"); return; }
-    FILE *dst = fopen("tmp_books.dat", "wb");
-    if (!dst) { fclose(src); printf("Unable to open temp file.\n"); return; }
+    if (!src) { lockRelease(&branch); lockRelease(&ledger); printf("No books.\n"); return; }
+    char tmp[PATH_LEN]; branchPath(tmp, sizeof(tmp), g_branch, "tmp_books.dat");
+    FILE *dst = fopen(tmp, "wb");
+    if (!dst) { fclose(src); lockRelease(&branch); lockRelease(&ledger); printf("Unable to open temp file.\n"); return; }
     struct Book b; int found = 0;
     while (fread(&b, sizeof(b), 1, src)) {
         if (b.id == id) { found = 1; continue; }
         fwrite(&b, sizeof(b), 1, dst);
     }
     fclose(src); fclose(dst);
-    remove(DATA_FILE); rename("tmp_books.dat", DATA_FILE);
+    remove(DATA_FILE); rename(tmp, DATA_FILE);
+    journalReplace(DATA_FILE);
+    lockRelease(&branch); lockRelease(&ledger);
+    indexRebuild(&bookIndex);
     if (found) printf("Book deleted.\n"); else printf("Book not found.\n");
 }
 static void viewAllBooksSorted(void) {
@@ -326,10 +1215,15 @@ static int matchWords(const char *text, const char *keyword) {
     strncpy(textLower, text, sizeof(textLower)-1); textLower[sizeof(textLower)-1]=0;
     strncpy(keyLower, keyword, sizeof(keyLower)-1); keyLower[sizeof(keyLower)-1]=0;
     toLowerStr(textLower); toLowerStr(keyLower);
-    char *tok = strtok(keyLower, " ");
-    while (tok) {
-        if (!strstr(textLower, tok)) return 0;
-        tok = strtok(NULL, " ");
+    char *tok = keyLower;
+    while (*tok) {
+        if (*tok == ' ') { tok++; continue; }
+        char *end = tok + strcspn(tok, " ");
+        char saved = *end; *end = 0;
+        int hit = strstr(textLower, tok) != NULL;
+        *end = saved;
+        if (!hit) return 0;
+        tok = end;
     }
     return 1;
 }
@@ -363,27 +1257,44 @@ static void addStudent(void) {
     struct Student s; s.id = id;
     getchar(); 
     printf("Enter Student Name: "); readLineSafe(s.name, sizeof(s.name));
+    struct FileLock branch;
+    if (!lockBranch(&branch, g_branch)) return;
+    if (studentIdDuplicate(id)) { lockRelease(&branch); printf("Student ID already exists.\n"); return; }
     FILE *f = fopen(STUDENT_FILE, "ab");
-    if (!f) { printf("Unable to open student file.\n"); return; }
-    fwrite(&s, sizeof(s), 1, f); fclose(f);
+    if (!f) { lockRelease(&branch); printf("Unable to open student file.\n"); return; }
+    loggedWrite(f, STUDENT_FILE, &s, sizeof(s));
+    long rec = ftell(f) / (long)sizeof(s) - 1;
+    fclose(f);
+    indexAdd(&studentIndex, s.id, rec);
+    lockRelease(&branch);
     printf("Student added.\n");
 }
 
 static void removeStudent(void) {
     printf("Enter Student ID to remove: ");
     int id; if (!readInt(&id)) { printf("Invalid input.\n"); return; }
-    if (studentHasUnreturned(id)) { printf("Student has unreturned books. Cannot remove.\n"); return; }
+    struct FileLock ledger, branch;
+    if (!lockLedger(&ledger)) return;
+    if (!lockBranch(&branch, g_branch)) { lockRelease(&ledger); return; }
+    if (studentHasUnreturned(id)) {
+        lockRelease(&branch); lockRelease(&ledger);
+        printf("Student has unreturned books. Cannot remove.\n"); return;
+    }
     FILE *src = fopen(STUDENT_FILE, "rb");
-    if (!src) { printf("No students.\n"); return; }
-    FILE *dst = fopen("tmp_students.dat", "wb");
-    if (!dst) { fclose(src); printf("Unable to open temp file.\n"); return; }
+    if (!src) { lockRelease(&branch); lockRelease(&ledger); printf("No students.\n"); return; }
+    char tmp[PATH_LEN]; branchPath(tmp, sizeof(tmp), g_branch, "tmp_students.dat");
+    FILE *dst = fopen(tmp, "wb");
+    if (!dst) { fclose(src); lockRelease(&branch); lockRelease(&ledger); printf("Unable to open temp file.\n"); return; }
     struct Student s; int found = 0;
     while (fread(&s, sizeof(s), 1, src)) {
         if (s.id == id) { found = 1; continue; }
         fwrite(&s, sizeof(s), 1, dst);
     }
     fclose(src); fclose(dst);
-    remove(STUDENT_FILE); rename("tmp_students.dat", STUDENT_FILE);
+    remove(STUDENT_FILE); rename(tmp, STUDENT_FILE);
+    journalReplace(STUDENT_FILE);
+    lockRelease(&branch); lockRelease(&ledger);
+    indexRebuild(&studentIndex);
     if (found) printf("Student removed.\n"); else printf("Student not found.\n");
 }
 static struct Issue *loadAllIssues(size_t *outCount) {
@@ -420,74 +1331,48 @@ static void issueBook(int requester_student_id) {
     struct Book b;
     if (!bookExists(book_id, &b)) { printf("Book not found.\n"); return; }
     if (!b.available) { printf("Book not available.\n"); return; }
-    FILE *fb = fopen(DATA_FILE, "rb+");
-    if (fb) {
-        struct Book tb;
-        while (fread(&tb, sizeof(tb), 1, fb)) {
-            if (tb.id == book_id) {
-                tb.available = 0;
-                fseek(fb, - (long)sizeof(tb), SEEK_CUR);
-                fwrite(&tb, sizeof(tb), 1, fb);
-                break;
-            }
-        }
-        fclose(fb);
-    }
-    struct Issue iss;
-    iss.book_id = book_id;
-    iss.student_id = requester_student_id;
-    iss.issue_time = time(NULL);
     printf("Enter due days (e.g., 14): ");
     int dd; if (!readInt(&dd)) dd = 14;
     if (dd <= 0) dd = 14;
-    iss.due_days = dd;
-    iss.returned = 0;
-    iss.return_time = 0;
+    struct FileLock branch;
+    if (!lockBranch(&branch, g_branch)) return;
+    // Re-check under the lock: another desk may have lent it meanwhile.
+    if (!bookExists(book_id, &b) || !b.available) { lockRelease(&branch); printf("Book not available.\n"); return; }
+    struct Issue iss;
+    issueInit(&iss, book_id, requester_student_id, time(NULL), dd);
     FILE *fi = fopen(ISSUE_FILE, "ab");
-    if (!fi) { printf("Unable to write issue record.\n"); return; }
-    fwrite(&iss, sizeof(iss), 1, fi);
+    if (!fi) { lockRelease(&branch); printf("Unable to write issue record.\n"); return; }
+    setBookAvailable(DATA_FILE, book_id, 0);
+    loggedWrite(fi, ISSUE_FILE, &iss, sizeof(iss));
     fclose(fi);
+    lockRelease(&branch);
     printf("Book issued to %s (ID %d). Due in %d days.\n", sname, requester_student_id, iss.due_days);
 }
 
 static void returnBookByStudent(int requester_student_id) {
     printf("Enter Book ID to return: ");
     int book_id; if (!readInt(&book_id)) { printf("Invalid input.\n"); return; }
+    struct FileLock branch;
+    if (!lockBranch(&branch, g_branch)) return;
     size_t count = 0; struct Issue *all = loadAllIssues(&count);
-    if (!all) { printf("No issue records.\n"); return; }
+    if (!all) { lockRelease(&branch); printf("No issue records.\n"); return; }
     int foundIdx = -1;
     for (size_t i = 0; i < count; i++) {
         if (all[i].book_id == book_id && all[i].student_id == requester_student_id && all[i].returned == 0) {
             foundIdx = (int)i; break;
         }
     }
-    if (foundIdx < 0) { printf("No matching issue record found for this student.\n"); free(all); return; }
-    all[foundIdx].returned = 1;
-    all[foundIdx].return_time = time(NULL);
-    FILE *fi = fopen(ISSUE_FILE, "wb");
-    if (!fi) { printf("Unable to update issue records.\n"); free(all); return; }
-    for (size_t i = 0; i < count; i++) fwrite(&all[i], sizeof(all[i]), 1, fi);
+    if (foundIdx < 0) { lockRelease(&branch); printf("No matching issue record found for this student.\n"); free(all); return; }
+    issueMarkReturned(&all[foundIdx], time(NULL));
+    FILE *fi = fopen(ISSUE_FILE, "rb+");
+    if (!fi) { lockRelease(&branch); printf("Unable to update issue records.\n"); free(all); return; }
+    fseek(fi, (long)foundIdx * (long)sizeof(all[foundIdx]), SEEK_SET);
+    loggedWrite(fi, ISSUE_FILE, &all[foundIdx], sizeof(all[foundIdx]));
     fclose(fi);
-    FILE *fb = fopen(DATA_FILE, "rb+");
-    if (fb) {
-        struct Book b;
-        while (fread(&b, sizeof(b), 1, fb)) {
-            if (b.id == book_id) {
-                b.available = 1;
-                fseek(fb, - (long)sizeof(b), SEEK_CUR);
-                fwrite(&b, sizeof(b), 1, fb);
-                break;
-            }
-        }
-        fclose(fb);
-    }
-    time_t issueT = all[foundIdx].issue_time;
-    int due_days = all[foundIdx].due_days;
-    time_t due = issueT + (time_t)due_days * 24 * 3600;
-    time_t now = all[foundIdx].return_time;
-    double secondsLate = difftime(now, due);
-    long daysLate = secondsLate > 0 ? (long)((secondsLate + 24*3600 - 1) / (24*3600)) : 0; // ceil-ish
-    long fine = daysLate * FINE_PER_DAY;
+    setBookAvailable(DATA_FILE, book_id, 1);
+    lockRelease(&branch);
+    long daysLate = lateDays(all[foundIdx].due_time, all[foundIdx].return_time);
+    long fine = fineFor(daysLate);
     char sname[120]; getStudentNameById(requester_student_id, sname, sizeof(sname));
     printf("Book returned by %s (ID %d).\n", sname, requester_student_id);
     if (daysLate > 0) printf("Late by %ld day(s). Fine: ₹%ld\n", daysLate, fine);
@@ -501,17 +1386,25 @@ static void viewStudentIssued(int student_id) {
     struct Issue iss;
     while (fread(&iss, sizeof(iss), 1, fi)) {
         if (iss.student_id == student_id && !iss.returned) {
-            char it[64], dt[64]; struct tm tm1;
-            safeLocalTime(&tm1, &iss.issue_time);
-            strftime(it, sizeof(it), "%Y-%m-%d", &tm1);
-            time_t due = iss.issue_time + (time_t)iss.due_days * 24 * 3600;
-            safeLocalTime(&tm1, &due);
-            strftime(dt, sizeof(dt), "%Y-%m-%d", &tm1);
+            char it[16], dt[16];
+            formatDay(iss.issue_day, it);
+            formatDay(iss.due_day, dt);
             printf("Book ID: %d | Issued: %s | Due: %s\n", iss.book_id, it, dt);
             found = 1;
         }
     }
     fclose(fi);
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    struct BranchLoan ln;
+    while (nextBranchLoan(fl, 1, &ln)) {
+        if (ln.iss.student_id != student_id || ln.iss.returned) continue;
+        char it[16], dt[16];
+        formatDay(ln.iss.issue_day, it);
+        formatDay(ln.iss.due_day, dt);
+        printf("Book ID: %d (branch %s) | Issued: %s | Due: %s\n", ln.iss.book_id, ln.lending, it, dt);
+        found = 1;
+    }
+    if (fl) fclose(fl);
     if (!found) printf("No issued books for this student.\n");
 }
 static void viewIssuedReport(void) {
@@ -520,37 +1413,51 @@ static void viewIssuedReport(void) {
     printf("\nBookID StudentID IssueDate  DueDate    Returned ReturnDate\n");
     struct Issue iss;
     while (fread(&iss, sizeof(iss), 1, fi)) {
-        char idt[64], ddt[64], rdt[64]; struct tm tm1;
-        safeLocalTime(&tm1, &iss.issue_time);
-        strftime(idt, sizeof(idt), "%Y-%m-%d", &tm1);
-        time_t due = iss.issue_time + (time_t)iss.due_days * 24 * 3600;
-        safeLocalTime(&tm1, &due);
-        strftime(ddt, sizeof(ddt), "%Y-%m-%d", &tm1);
-        if (iss.returned) { safeLocalTime(&tm1, &iss.return_time); strftime(rdt, sizeof(rdt), "%Y-%m-%d", &tm1); }
-        else strcpy(rdt, "-");
+        char idt[16], ddt[16], rdt[16];
+        formatDay(iss.issue_day, idt);
+        formatDay(iss.due_day, ddt);
+        formatReturnDay(&iss, rdt);
         printf("%-6d %-9d %-10s %-10s %-8s %s\n",
                iss.book_id, iss.student_id, idt, ddt, iss.returned ? "Yes" : "No", rdt);
     }
     fclose(fi);
+    // Books of this branch lent to students of other branches.
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    struct BranchLoan ln;
+    while (nextBranchLoan(fl, 0, &ln)) {
+        char idt[16], ddt[16], rdt[16];
+        formatDay(ln.iss.issue_day, idt);
+        formatDay(ln.iss.due_day, ddt);
+        formatReturnDay(&ln.iss, rdt);
+        printf("%-6d %-9d %-10s %-10s %-8s %-10s (branch %s)\n",
+               ln.iss.book_id, ln.iss.student_id, idt, ddt, ln.iss.returned ? "Yes" : "No", rdt, ln.home);
+    }
+    if (fl) fclose(fl);
     printf("\nExport issued report to CSV? (y/n): ");
     char ans[8]; readLineSafe(ans, sizeof(ans));
     if (ans[0]=='y' || ans[0]=='Y') {
         FILE *fout = fopen("issued_report.csv", "w");
         if (!fout) { printf("Unable to write CSV.\n"); return; }
-        fprintf(fout, "BookID,StudentID,IssueDate,DueDate,Returned,ReturnDate\n");
+        fprintf(fout, "BookID,StudentID,IssueDate,DueDate,Returned,ReturnDate,StudentBranch\n");
         fi = fopen(ISSUE_FILE, "rb");
-        while (fread(&iss, sizeof(iss), 1, fi)) {
-            char idt[64], ddt[64], rdt[64]; struct tm tm1;
-            safeLocalTime(&tm1, &iss.issue_time);
-            strftime(idt, sizeof(idt), "%Y-%m-%d", &tm1);
-            time_t due = iss.issue_time + (time_t)iss.due_days * 24 * 3600;
-            safeLocalTime(&tm1, &due);
-            strftime(ddt, sizeof(ddt), "%Y-%m-%d", &tm1);
-            if (iss.returned) { safeLocalTime(&tm1, &iss.return_time); strftime(rdt, sizeof(rdt), "%Y-%m-%d", &tm1); }
-            else strcpy(rdt, "-");
-            fprintf(fout, "%d,%d,%s,%s,%s,%s\n", iss.book_id, iss.student_id, idt, ddt, iss.returned ? "Yes" : "No", rdt);
-        }
-        fclose(fi); fclose(fout);
+        while (fi && fread(&iss, sizeof(iss), 1, fi)) {
+            char idt[16], ddt[16], rdt[16];
+            formatDay(iss.issue_day, idt);
+            formatDay(iss.due_day, ddt);
+            formatReturnDay(&iss, rdt);
+            fprintf(fout, "%d,%d,%s,%s,%s,%s,%s\n", iss.book_id, iss.student_id, idt, ddt, iss.returned ? "Yes" : "No", rdt, g_branch);
+        }
+        if (fi) fclose(fi);
+        fl = fopen(LOAN_FILE, "rb");
+        while (nextBranchLoan(fl, 0, &ln)) {
+            char idt[16], ddt[16], rdt[16];
+            formatDay(ln.iss.issue_day, idt);
+            formatDay(ln.iss.due_day, ddt);
+            formatReturnDay(&ln.iss, rdt);
+            fprintf(fout, "%d,%d,%s,%s,%s,%s,%s\n", ln.iss.book_id, ln.iss.student_id, idt, ddt, ln.iss.returned ? "Yes" : "No", rdt, ln.home);
+        }
+        if (fl) fclose(fl);
+        fclose(fout);
         printf("Exported to issued_report.csv\n");
     }
 }
@@ -560,21 +1467,30 @@ static void checkOverdue(void) {
     int any = 0; time_t now = time(NULL);
     struct Issue iss;
     while (fread(&iss, sizeof(iss), 1, fi)) {
-        if (!iss.returned) {
-            time_t due = iss.issue_time + (time_t)iss.due_days * 24 * 3600;
-            if (now > due) {
-                char idt[64], ddt[64]; struct tm tm1;
-                safeLocalTime(&tm1, &iss.issue_time);
-                strftime(idt, sizeof(idt), "%Y-%m-%d", &tm1);
-                safeLocalTime(&tm1, &due);
-                strftime(ddt, sizeof(ddt), "%Y-%m-%d", &tm1);
-                printf("Overdue -> BookID %d | StudentID %d | Issued: %s | Due: %s\n",
-                       iss.book_id, iss.student_id, idt, ddt);
-                any = 1;
-            }
+        if (!iss.returned && now > iss.due_time) {
+            char idt[16], ddt[16];
+            formatDay(iss.issue_day, idt);
+            formatDay(iss.due_day, ddt);
+            printf("Overdue -> BookID %d | StudentID %d | Issued: %s | Due: %s\n",
+                   iss.book_id, iss.student_id, idt, ddt);
+            any = 1;
         }
     }
     fclose(fi);
+    // Loans from other branches to students of this branch.
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    struct BranchLoan ln;
+    while (nextBranchLoan(fl, 1, &ln)) {
+        if (!ln.iss.returned && now > ln.iss.due_time) {
+            char idt[16], ddt[16];
+            formatDay(ln.iss.issue_day, idt);
+            formatDay(ln.iss.due_day, ddt);
+            printf("Overdue -> BookID %d (branch %s) | StudentID %d | Issued: %s | Due: %s\n",
+                   ln.iss.book_id, ln.lending, ln.iss.student_id, idt, ddt);
+            any = 1;
+        }
+    }
+    if (fl) fclose(fl);
     if (!any) printf("No overdue books.\n");
     else {
         printf("\nExport overdue report to CSV? (y/n): ");
@@ -582,26 +1498,30 @@ static void checkOverdue(void) {
         if (ans[0]=='y' || ans[0]=='Y') {
             FILE *fout = fopen("overdue_report.csv", "w");
             if (!fout) { printf("Unable to write CSV.\n"); return; }
-            fprintf(fout, "BookID,StudentID,IssueDate,DueDate,DaysOverdue,Fine\n");
+            fprintf(fout, "BookID,StudentID,IssueDate,DueDate,DaysOverdue,Fine,BookBranch\n");
             fi = fopen(ISSUE_FILE, "rb");
-            time_t now2 = time(NULL);
-            while (fread(&iss, sizeof(iss), 1, fi)) {
-                if (!iss.returned) {
-                    time_t due = iss.issue_time + (time_t)iss.due_days * 24 * 3600;
-                    if (now2 > due) {
-                        char idt[64], ddt[64]; struct tm tm1;
-                        safeLocalTime(&tm1, &iss.issue_time);
-                        strftime(idt, sizeof(idt), "%Y-%m-%d", &tm1);
-                        safeLocalTime(&tm1, &due);
-                        strftime(ddt, sizeof(ddt), "%Y-%m-%d", &tm1);
-                        double secondsLate = difftime(now2, due);
-                        long daysLate = secondsLate > 0 ? (long)((secondsLate + 24*3600 - 1) / (24*3600)) : 0;
-                        long fine = daysLate * FINE_PER_DAY;
-                        fprintf(fout, "%d,%d,%s,%s,%ld,%ld\n", iss.book_id, iss.student_id, idt, ddt, daysLate, fine);
-                    }
+            while (fi && fread(&iss, sizeof(iss), 1, fi)) {
+                if (!iss.returned && now > iss.due_time) {
+                    char idt[16], ddt[16];
+                    formatDay(iss.issue_day, idt);
+                    formatDay(iss.due_day, ddt);
+                    long daysLate = lateDays(iss.due_time, now);
+                    fprintf(fout, "%d,%d,%s,%s,%ld,%ld,%s\n", iss.book_id, iss.student_id, idt, ddt, daysLate, fineFor(daysLate), g_branch);
                 }
             }
-            fclose(fi); fclose(fout);
+            if (fi) fclose(fi);
+            fl = fopen(LOAN_FILE, "rb");
+            while (nextBranchLoan(fl, 1, &ln)) {
+                if (!ln.iss.returned && now > ln.iss.due_time) {
+                    char idt[16], ddt[16];
+                    formatDay(ln.iss.issue_day, idt);
+                    formatDay(ln.iss.due_day, ddt);
+                    long daysLate = lateDays(ln.iss.due_time, now);
+                    fprintf(fout, "%d,%d,%s,%s,%ld,%ld,%s\n", ln.iss.book_id, ln.iss.student_id, idt, ddt, daysLate, fineFor(daysLate), ln.lending);
+                }
+            }
+            if (fl) fclose(fl);
+            fclose(fout);
             printf("Exported to overdue_report.csv\n");
         }
     }
@@ -628,16 +1548,25 @@ static void studentHistory(int student_id) {
     printf("History for student ID %d:\n", student_id);
     while (fread(&iss, sizeof(iss), 1, fi)) {
         if (iss.student_id == student_id) {
-            char it[64], rt[64]; struct tm tm1;
-            safeLocalTime(&tm1, &iss.issue_time);
-            strftime(it, sizeof(it), "%Y-%m-%d", &tm1);
-            if (iss.returned) { safeLocalTime(&tm1, &iss.return_time); strftime(rt, sizeof(rt), "%Y-%m-%d", &tm1); }
-            else strcpy(rt, "-");
+            char it[16], rt[16];
+            formatDay(iss.issue_day, it);
+            formatReturnDay(&iss, rt);
             printf("Book %d | Issued %s | Due %d days | Returned %s\n", iss.book_id, it, iss.due_days, rt);
             found = 1;
         }
     }
     fclose(fi);
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    struct BranchLoan ln;
+    while (nextBranchLoan(fl, 1, &ln)) {
+        if (ln.iss.student_id != student_id) continue;
+        char it[16], rt[16];
+        formatDay(ln.iss.issue_day, it);
+        formatReturnDay(&ln.iss, rt);
+        printf("Book %d (branch %s) | Issued %s | Due %d days | Returned %s\n", ln.iss.book_id, ln.lending, it, ln.iss.due_days, rt);
+        found = 1;
+    }
+    if (fl) fclose(fl);
     if (!found) printf("No history for this student.\n");
 }
 static int copyFile(const char *src, const char *dst) {
@@ -653,21 +1582,746 @@ static int copyFile(const char *src, const char *dst) {
 }
 
 static void backupDatabase(void) {
-    int ok1 = copyFile(DATA_FILE, "books_backup.dat");
-    int ok2 = copyFile(STUDENT_FILE, "students_backup.dat");
-    int ok3 = copyFile(ISSUE_FILE, "issues_backup.dat");
+    char bb[PATH_LEN], sb[PATH_LEN], ib[PATH_LEN];
+    branchPath(bb, sizeof(bb), g_branch, "books_backup.dat");
+    branchPath(sb, sizeof(sb), g_branch, "students_backup.dat");
+    branchPath(ib, sizeof(ib), g_branch, "issues_backup.dat");
+    int ok1 = copyFile(DATA_FILE, bb);
+    int ok2 = copyFile(STUDENT_FILE, sb);
+    int ok3 = copyFile(ISSUE_FILE, ib);
+    indexesCheckpoint();
+    journalCompact();
     if (ok1 || ok2 || ok3) printf("Backup completed.\n"); else printf("Nothing to backup or failed.\n");
 }
 static void restoreDatabase(void) {
-    int ok1 = copyFile("books_backup.dat", DATA_FILE);
-    int ok2 = copyFile("students_backup.dat", STUDENT_FILE);
-    int ok3 = copyFile("issues_backup.dat", ISSUE_FILE);
+    char bb[PATH_LEN], sb[PATH_LEN], ib[PATH_LEN];
+    branchPath(bb, sizeof(bb), g_branch, "books_backup.dat");
+    branchPath(sb, sizeof(sb), g_branch, "students_backup.dat");
+    branchPath(ib, sizeof(ib), g_branch, "issues_backup.dat");
+    int ok1 = copyFile(bb, DATA_FILE);
+    int ok2 = copyFile(sb, STUDENT_FILE);
+    int ok3 = copyFile(ib, ISSUE_FILE);
+    journalReplace(DATA_FILE);
+    journalReplace(STUDENT_FILE);
+    journalReplace(ISSUE_FILE);
+    indexRebuild(&bookIndex);
+    indexRebuild(&studentIndex);
     if (ok1 || ok2 || ok3) printf("Restore completed.\n"); else printf("No backup files found.\n");
 }
+static int validBranchCode(const char *code) {
+    size_t n = strlen(code);
+    if (n == 0 || n >= BRANCH_CODE_LEN) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!isalnum((unsigned char)code[i]) && code[i] != '_' && code[i] != '-') return 0;
+    }
+    return 1;
+}
+
+static int loadBranches(char codes[][BRANCH_CODE_LEN], int max) {
+    int n = 0;
+    snprintf(codes[n++], BRANCH_CODE_LEN, "%s", MAIN_BRANCH);
+    FILE *f = fopen(BRANCH_CFG, "r");
+    if (!f) return n;
+    char line[64];
+    while (n < max && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (validBranchCode(line) && strcmp(line, MAIN_BRANCH) != 0) strcpy(codes[n++], line);
+    }
+    fclose(f);
+    return n;
+}
+
+static int branchKnown(const char *code) {
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    int n = loadBranches(codes, MAX_BRANCHES);
+    for (int i = 0; i < n; i++) if (strcmp(codes[i], code) == 0) return 1;
+    return 0;
+}
+
+static void listBranches(void) {
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    int n = loadBranches(codes, MAX_BRANCHES);
+    printf("Branches:");
+    for (int i = 0; i < n; i++) printf(" %s%s", codes[i], strcmp(codes[i], g_branch) == 0 ? "*" : "");
+    printf("\n");
+}
+
+static void selectBranch(const char *code) {
+    indexesCheckpoint();
+    setBranchPaths(code);
+    ensureDataFilesExist();
+    indexesOpen();
+}
+
+static void addBranch(void) {
+    printf("Enter new branch code (letters, digits, _ or -): ");
+    char code[64]; readLineSafe(code, sizeof(code));
+    if (!validBranchCode(code)) { printf("Invalid branch code.\n"); return; }
+    if (branchKnown(code)) { printf("Branch already exists.\n"); return; }
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    if (loadBranches(codes, MAX_BRANCHES) >= MAX_BRANCHES) { printf("Too many branches.\n"); return; }
+    FILE *f = fopen(BRANCH_CFG, "a");
+    if (!f) { printf("Unable to save branch list.\n"); return; }
+    fprintf(f, "%s\n", code);
+    fclose(f);
+    journalReplace(BRANCH_CFG);
+    char dir[PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s/%s", BRANCH_DIR, code);
+    makeDir(BRANCH_DIR);
+    makeDir(dir);
+    printf("Branch %s added.\n", code);
+}
+
+static void switchBranch(void) {
+    listBranches();
+    printf("Enter branch code: ");
+    char code[64]; readLineSafe(code, sizeof(code));
+    if (!branchKnown(code)) { printf("Unknown branch.\n"); return; }
+    selectBranch(code);
+    printf("Now working at branch %s.\n", g_branch);
+}
+
+// Fan-out across branch partitions: one worker per branch scans that
+// branch's files into its own result buffer, then the results are merged.
+struct BranchScan {
+    char branch[BRANCH_CODE_LEN];
+    const char *keyword;
+    time_t now;
+    struct Book *books;
+    struct Issue *issues;
+    size_t count;
+};
+
+struct BranchBook {
+    const char *branch;
+    struct Book book;
+};
+
+struct BranchIssue {
+    const char *branch;
+    const char *home;
+    struct Issue iss;
+};
+
+static void searchBranchTask(void *arg) {
+    struct BranchScan *sc = arg;
+    char path[PATH_LEN]; branchPath(path, sizeof(path), sc->branch, "books.dat");
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    size_t cap = 0;
+    struct Book b;
+    while (fread(&b, sizeof(b), 1, f)) {
+        if (!matchWords(b.title, sc->keyword) && !matchWords(b.author, sc->keyword)) continue;
+        if (sc->count + 1 > cap) {
+            cap = cap ? cap * 2 : 64;
+            struct Book *p = realloc(sc->books, cap * sizeof(*p));
+            if (!p) break;
+            sc->books = p;
+        }
+        sc->books[sc->count++] = b;
+    }
+    fclose(f);
+}
+
+static void overdueBranchTask(void *arg) {
+    struct BranchScan *sc = arg;
+    char path[PATH_LEN]; branchPath(path, sizeof(path), sc->branch, "issues.dat");
+    FILE *fi = fopen(path, "rb");
+    if (!fi) return;
+    size_t cap = 0;
+    struct Issue iss;
+    while (fread(&iss, sizeof(iss), 1, fi)) {
+        if (iss.returned || sc->now <= iss.due_time) continue;
+        if (sc->count + 1 > cap) {
+            cap = cap ? cap * 2 : 64;
+            struct Issue *p = realloc(sc->issues, cap * sizeof(*p));
+            if (!p) break;
+            sc->issues = p;
+        }
+        sc->issues[sc->count++] = iss;
+    }
+    fclose(fi);
+}
+
+static struct BranchScan *scanBranches(TaskFn fn, const char *keyword, time_t now, int *outCount) {
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    int n = loadBranches(codes, MAX_BRANCHES);
+    struct BranchScan *scans = calloc((size_t)n, sizeof(*scans));
+    if (!scans) { *outCount = 0; return NULL; }
+    for (int i = 0; i < n; i++) {
+        memcpy(scans[i].branch, codes[i], BRANCH_CODE_LEN);
+        scans[i].keyword = keyword;
+        scans[i].now = now;
+    }
+    runParallel(fn, scans, sizeof(*scans), n);
+    *outCount = n;
+    return scans;
+}
+
+static void freeBranchScans(struct BranchScan *scans, int n) {
+    for (int i = 0; i < n; i++) { free(scans[i].books); free(scans[i].issues); }
+    free(scans);
+}
+
+static int cmpBranchBook(const void *a, const void *b) {
+    const struct BranchBook *x = a, *y = b;
+    if (x->book.id != y->book.id) return (x->book.id > y->book.id) - (x->book.id < y->book.id);
+    return strcmp(x->branch, y->branch);
+}
+
+static int cmpBranchIssueDue(const void *a, const void *b) {
+    const struct BranchIssue *x = a, *y = b;
+    time_t dx = x->iss.due_time, dy = y->iss.due_time;
+    if (dx != dy) return (dx > dy) - (dx < dy);
+    return strcmp(x->branch, y->branch);
+}
+
+static void searchAllBranches(void) {
+    printf("Enter keyword (title or author): ");
+    char keyword[200]; readLineSafe(keyword, sizeof(keyword));
+    if (keyword[0]==0) { printf("Empty keyword.\n"); return; }
+    int n; struct BranchScan *scans = scanBranches(searchBranchTask, keyword, 0, &n);
+    if (!scans) { printf("Memory error.\n"); return; }
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += scans[i].count;
+    if (total == 0) { printf("No matching books.\n"); freeBranchScans(scans, n); return; }
+    struct BranchBook *rows = malloc(total * sizeof(*rows));
+    if (!rows) { printf("Memory error.\n"); freeBranchScans(scans, n); return; }
+    size_t k = 0;
+    for (int i = 0; i < n; i++) {
+        for (size_t j = 0; j < scans[i].count; j++) { rows[k].branch = scans[i].branch; rows[k].book = scans[i].books[j]; k++; }
+    }
+    qsort(rows, total, sizeof(*rows), cmpBranchBook);
+    printf("\n%-15s %-5s %-30s %-20s %-10s\n", "Branch", "ID", "Title", "Author", "Status");
+    printf("--------------------------------------------------------------------------------\n");
+    for (size_t i = 0; i < total; i++) {
+        printf("%-15s %-5d %-30s %-20s %-10s\n", rows[i].branch, rows[i].book.id, rows[i].book.title,
+               rows[i].book.author, rows[i].book.available ? "Available" : "Issued");
+    }
+    free(rows);
+    freeBranchScans(scans, n);
+}
+
+static void overdueAllBranches(void) {
+    time_t now = time(NULL);
+    int n; struct BranchScan *scans = scanBranches(overdueBranchTask, NULL, now, &n);
+    if (!scans) { printf("Memory error.\n"); return; }
+    size_t total = 0, cap = 0;
+    struct BranchIssue *rows = NULL;
+    for (int i = 0; i < n; i++) {
+        for (size_t j = 0; j < scans[i].count; j++) {
+            if (total + 1 > cap) {
+                cap = cap ? cap * 2 : 64;
+                struct BranchIssue *p = realloc(rows, cap * sizeof(*p));
+                if (!p) { free(rows); freeBranchScans(scans, n); printf("Memory error.\n"); return; }
+                rows = p;
+            }
+            rows[total].branch = scans[i].branch;
+            rows[total].home = scans[i].branch;
+            rows[total].iss = scans[i].issues[j];
+            total++;
+        }
+    }
+    // Inter-branch loans live in the shared ledger rather than a branch's issue file.
+    struct BranchLoan *loans = NULL; size_t nloans = 0, loanCap = 0;
+    FILE *fl = fopen(LOAN_FILE, "rb");
+    if (fl) {
+        struct BranchLoan ln;
+        while (fread(&ln, sizeof(ln), 1, fl)) {
+            if (ln.iss.returned || now <= ln.iss.due_time) continue;
+            if (nloans + 1 > loanCap) {
+                loanCap = loanCap ? loanCap * 2 : 16;
+                struct BranchLoan *p = realloc(loans, loanCap * sizeof(*p));
+                if (!p) break;
+                loans = p;
+            }
+            loans[nloans++] = ln;
+        }
+        fclose(fl);
+    }
+    if (total + nloans > cap) {
+        struct BranchIssue *p = realloc(rows, (total + nloans) * sizeof(*p));
+        if (!p) nloans = 0; else rows = p;
+    }
+    for (size_t j = 0; j < nloans; j++) {
+        rows[total].branch = loans[j].lending;
+        rows[total].home = loans[j].home;
+        rows[total].iss = loans[j].iss;
+        total++;
+    }
+    if (total == 0) printf("No overdue books.\n");
+    else {
+        qsort(rows, total, sizeof(*rows), cmpBranchIssueDue);
+        printf("\n%-15s %-15s %-6s %-9s %-10s %-10s %-5s %s\n", "Branch", "HomeBranch", "BookID", "StudentID", "IssueDate", "DueDate", "Days", "Fine");
+        for (size_t i = 0; i < total; i++) {
+            char idt[16], ddt[16];
+            formatDay(rows[i].iss.issue_day, idt);
+            formatDay(rows[i].iss.due_day, ddt);
+            long daysLate = lateDays(rows[i].iss.due_time, now);
+            printf("%-15s %-15s %-6d %-9d %-10s %-10s %-5ld %ld\n", rows[i].branch, rows[i].home,
+                   rows[i].iss.book_id, rows[i].iss.student_id, idt, ddt, daysLate, fineFor(daysLate));
+        }
+    }
+    free(loans);
+    free(rows);
+    freeBranchScans(scans, n);
+}
+
+static void borrowFromBranch(int student_id) {
+    listBranches();
+    printf("Enter lending branch code: ");
+    char code[64]; readLineSafe(code, sizeof(code));
+    if (!branchKnown(code)) { printf("Unknown branch.\n"); return; }
+    if (strcmp(code, g_branch) == 0) { printf("Book is at this branch. Use Issue Book instead.\n"); return; }
+    printf("Enter Book ID to borrow: ");
+    int book_id; if (!readInt(&book_id)) { printf("Invalid input.\n"); return; }
+    char path[PATH_LEN]; branchPath(path, sizeof(path), code, "books.dat");
+    struct Book b;
+    if (!findBookIn(path, book_id, &b)) { printf("Book not found at branch %s.\n", code); return; }
+    if (!b.available) { printf("Book not available.\n"); return; }
+    printf("Enter due days (e.g., 14): ");
+    int dd; if (!readInt(&dd)) dd = 14;
+    if (dd <= 0) dd = 14;
+    struct FileLock ledger, lender;
+    if (!lockLedger(&ledger)) return;
+    if (!lockBranch(&lender, code)) { lockRelease(&ledger); return; }
+    // Re-check under the locks: the lending branch may have issued it meanwhile.
+    if (!findBookIn(path, book_id, &b) || !b.available) {
+        lockRelease(&lender); lockRelease(&ledger);
+        printf("Book not available.\n"); return;
+    }
+    struct BranchLoan ln;
+    memset(&ln, 0, sizeof(ln));
+    strcpy(ln.lending, code);
+    snprintf(ln.home, sizeof(ln.home), "%s", g_branch);
+    issueInit(&ln.iss, book_id, student_id, time(NULL), dd);
+    FILE *fl = fopen(LOAN_FILE, "ab");
+    if (!fl) { lockRelease(&lender); lockRelease(&ledger); printf("Unable to write loan record.\n"); return; }
+    setBookAvailable(path, book_id, 0);
+    loggedWrite(fl, LOAN_FILE, &ln, sizeof(ln));
+    fclose(fl);
+    lockRelease(&lender); lockRelease(&ledger);
+    printf("Book '%s' borrowed from branch %s. Due in %d days.\n", b.title, code, dd);
+}
+
+static void returnBranchLoan(int student_id) {
+    printf("Enter Book ID to return: ");
+    int book_id; if (!readInt(&book_id)) { printf("Invalid input.\n"); return; }
+    struct FileLock ledger;
+    if (!lockLedger(&ledger)) return;
+    FILE *fl = fopen(LOAN_FILE, "rb+");
+    if (!fl) { lockRelease(&ledger); printf("No inter-branch loans.\n"); return; }
+    struct BranchLoan ln; int found = 0;
+    while (fread(&ln, sizeof(ln), 1, fl)) {
+        if (ln.iss.book_id == book_id && ln.iss.student_id == student_id && !ln.iss.returned && strcmp(ln.home, g_branch) == 0) {
+            found = 1; break;
+        }
+    }
+    if (!found) { fclose(fl); lockRelease(&ledger); printf("No matching inter-branch loan found for this student.\n"); return; }
+    // Lock the lending branch before closing the loan, so the loan is never
+    // closed while the book stays issued there.
+    struct FileLock lender;
+    if (!lockBranch(&lender, ln.lending)) { fclose(fl); lockRelease(&ledger); return; }
+    issueMarkReturned(&ln.iss, time(NULL));
+    fseek(fl, - (long)sizeof(ln), SEEK_CUR);
+    loggedWrite(fl, LOAN_FILE, &ln, sizeof(ln));
+    fclose(fl);
+    char path[PATH_LEN]; branchPath(path, sizeof(path), ln.lending, "books.dat");
+    setBookAvailable(path, book_id, 1);
+    lockRelease(&lender);
+    lockRelease(&ledger);
+    long daysLate = lateDays(ln.iss.due_time, ln.iss.return_time);
+    printf("Book returned to branch %s.\n", ln.lending);
+    if (daysLate > 0) printf("Late by %ld day(s). Fine: ₹%ld\n", daysLate, fineFor(daysLate));
+    else printf("Returned on time. No fine.\n");
+}
+
+static void issueFromV1(void *out, const void *in) {
+    const struct IssueV1 *old = in;
+    struct Issue *iss = out;
+    issueInit(iss, old->book_id, old->student_id, old->issue_time, old->due_days);
+    if (old->returned) issueMarkReturned(iss, old->return_time);
+}
+
+static void loanFromV1(void *out, const void *in) {
+    const struct BranchLoanV1 *old = in;
+    struct BranchLoan *ln = out;
+    memset(ln, 0, sizeof(*ln));
+    memcpy(ln->lending, old->lending, sizeof(ln->lending));
+    memcpy(ln->home, old->home, sizeof(ln->home));
+    issueInit(&ln->iss, old->book_id, old->student_id, old->issue_time, old->due_days);
+    if (old->returned) issueMarkReturned(&ln->iss, old->return_time);
+}
+
+struct MigrationTarget {
+    char path[PATH_LEN];
+    size_t oldSize, newSize;
+    void (*conv)(void *, const void *);
+};
+
+static int migrationTargets(struct MigrationTarget *t) {
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    int n = loadBranches(codes, MAX_BRANCHES), k = 0;
+    const char *names[] = { "issues.dat", "issues_backup.dat" };
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 2; j++, k++) {
+            branchPath(t[k].path, sizeof(t[k].path), codes[i], names[j]);
+            t[k].oldSize = sizeof(struct IssueV1); t[k].newSize = sizeof(struct Issue); t[k].conv = issueFromV1;
+        }
+    }
+    strcpy(t[k].path, LOAN_FILE);
+    t[k].oldSize = sizeof(struct BranchLoanV1); t[k].newSize = sizeof(struct BranchLoan); t[k].conv = loanFromV1;
+    return k + 1;
+}
+
+static void migPath(char *mig, const char *path) {
+    snprintf(mig, PATH_LEN + 4, "%.*s.mig", PATH_LEN - 1, path);
+}
+
+// Converts t->path into <path>.mig; the original is left untouched until
+// the new format is committed, so a failed or repeated run is harmless.
+static int migrateFile(const struct MigrationTarget *t) {
+    char mig[PATH_LEN + 4]; migPath(mig, t->path);
+    remove(mig);
+    long long size, mtime;
+    if (!fileStat(t->path, &size, &mtime) || size == 0) return 1;
+    if (size % (long long)t->oldSize != 0) { printf("%s has an unexpected size; not migrated.\n", t->path); return 0; }
+    FILE *src = fopen(t->path, "rb");
+    if (!src) return 0;
+    FILE *dst = fopen(mig, "wb");
+    if (!dst) { fclose(src); return 0; }
+    unsigned char in[sizeof(struct BranchLoanV1)], out[sizeof(struct BranchLoan)];
+    int ok = 1;
+    while (ok && fread(in, t->oldSize, 1, src)) {
+        t->conv(out, in);
+        ok = fwrite(out, t->newSize, 1, dst) == 1;
+    }
+    if (ferror(src)) ok = 0;
+    fclose(src);
+    if (fclose(dst) != 0) ok = 0;
+    if (!ok) { remove(mig); printf("Unable to migrate %s.\n", t->path); }
+    return ok;
+}
+
+// FORMAT_FILE is replaced through a temporary; while FORMAT_FILE is missing
+// the temporary holds the committed value.
+static int readDataFormat(void) {
+    const char *names[] = { FORMAT_FILE, FORMAT_FILE ".tmp" };
+    for (int i = 0; i < 2; i++) {
+        FILE *f = fopen(names[i], "r");
+        if (!f) continue;
+        int format, ok = fscanf(f, "%d", &format) == 1;
+        fclose(f);
+        if (ok) return format;
+    }
+    return 1;
+}
+
+static int writeDataFormat(int format) {
+    FILE *f = fopen(FORMAT_FILE ".tmp", "w");
+    if (!f) return 0;
+    int ok = fprintf(f, "%d\n", format) > 0;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) { remove(FORMAT_FILE ".tmp"); return 0; }
+    remove(FORMAT_FILE); rename(FORMAT_FILE ".tmp", FORMAT_FILE);
+    return 1;
+}
+
+// Brings issue files (and their backups) and the loan ledger of every
+// branch up to DATA_FORMAT, recorded in FORMAT_FILE. Every file is
+// converted aside first; writing FORMAT_FILE commits the migration, after
+// which the converted files replace the originals. That last step also
+// runs on every start, to finish a migration interrupted part way.
+static void migrateDataFormat(void) {
+    struct MigrationTarget t[MAX_BRANCHES * 2 + 1];
+    int n = migrationTargets(t);
+    if (readDataFormat() < DATA_FORMAT) {
+        int ok = 1;
+        for (int i = 0; i < n && ok; i++) ok = migrateFile(&t[i]);
+        if (!ok || !writeDataFormat(DATA_FORMAT)) {
+            for (int i = 0; i < n; i++) {
+                char mig[PATH_LEN + 4]; migPath(mig, t[i].path);
+                remove(mig);
+            }
+            printf("Data migration incomplete; data left unchanged, will retry on next start.\n");
+            return;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        char mig[PATH_LEN + 4]; migPath(mig, t[i].path);
+        long long size, mtime;
+        if (!fileStat(mig, &size, &mtime)) continue;
+        remove(t[i].path);
+        if (rename(mig, t[i].path) != 0) { printf("Unable to install migrated %s.\n", t[i].path); continue; }
+        journalReplace(t[i].path);
+    }
+}
+
+// Must differ from the epoch of any log a follower may still be reading.
+static unsigned long long newEpoch(unsigned long long old) {
+    time_t now = time(NULL);
+    clock_t c = clock();
+    unsigned long long e = ((unsigned long long)now << 24) ^ fnv1a(&c, sizeof(c), fnv1a(&now, sizeof(now), 2166136261u));
+    return (e == 0 || e == old) ? old + 1 : e;
+}
+
+// Starts a new log epoch that begins with a base copy of every partition.
+// A follower still on the old epoch resyncs from that copy.
+static int journalRotate(void) {
+    struct FileLock lk;
+    if (!lockAcquire(&lk, REPL_LOCK)) return 0;
+    struct LogHeader h;
+    FILE *f = fopen(REPL_LOG, "rb");
+    memset(&h, 0, sizeof(h));
+    if (f) { if (!fread(&h, sizeof(h), 1, f)) h.epoch = 0; fclose(f); }
+    unsigned long long old = h.epoch;
+    f = fopen(REPL_LOG, "wb");
+    memset(&h, 0, sizeof(h));
+    h.magic = REPL_MAGIC;
+    h.version = REPL_VERSION;
+    h.epoch = newEpoch(old);
+    h.base = h.endOffset = (long long)sizeof(h);
+    int ok = f && fwrite(&h, sizeof(h), 1, f) == 1;
+    if (f && fclose(f) != 0) ok = 0;
+    lockRelease(&lk);
+    if (!ok) return 0;
+    char codes[MAX_BRANCHES][BRANCH_CODE_LEN];
+    int n = loadBranches(codes, MAX_BRANCHES);
+    const char *names[] = { "books.dat", "students.dat", "issues.dat" };
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < 3; j++) {
+            char path[PATH_LEN]; branchPath(path, sizeof(path), codes[i], names[j]);
+            journalReplace(path);
+        }
+    }
+    journalReplace(BRANCH_CFG);
+    journalReplace(LOAN_FILE);
+    if ((f = journalBegin(&lk, &h)) != NULL) {
+        h.snapEnd = h.endOffset;
+        journalEnd(f, &h, &lk);
+    }
+    return 1;
+}
+
+static void startReplicationLog(void) {
+    if (!journalRotate()) { printf("Unable to create %s.\n", REPL_LOG); return; }
+    struct LogHeader h;
+    if (journalReadHeader(&h)) printf("Replication log active at seq %llu.\n", h.lastSeq);
+}
+
+// Run on exit: compacts the log, and if the changes logged since the base
+// copy are still over REPL_MAX_BYTES (no follower, or one far behind)
+// rotates it to a new epoch.
+static void journalCheckpoint(void) {
+    journalCompact();
+    struct LogHeader h;
+    if (journalReadHeader(&h) && h.endOffset - (h.snapEnd > h.base ? h.snapEnd : h.base) > REPL_MAX_BYTES) journalRotate();
+}
+
+static int replicaSaveState(const struct ReplicaState *st) {
+    FILE *f = fopen(REPLICA_STATE ".tmp", "wb");
+    if (!f) return 0;
+    int ok = fwrite(st, sizeof(*st), 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) return 0;
+    remove(REPLICA_STATE); rename(REPLICA_STATE ".tmp", REPLICA_STATE);
+    return 1;
+}
+
+// Applies record r, whose data is next in `log`. Whole files are streamed
+// into a temporary and renamed once their checksum matches. Returns 1 when
+// applied, 0 when the replica cannot be written, -1 on a torn record.
+static int replicaApply(FILE *log, const struct LogRecord *r, const char *rel) {
+    if (rel[0] == '/' || rel[0] == '\\' || strstr(rel, "..")) return 0;
+    char path[PATH_LEN + sizeof(REPLICA_DIR)];
+    int n = snprintf(path, sizeof(path), "%s/%s", REPLICA_DIR, rel);
+    if (n < 0 || (size_t)n >= sizeof(path)) return 0;
+    for (char *p = path + strlen(REPLICA_DIR) + 1; *p; p++) {
+        if (*p == '/') { *p = 0; makeDir(path); *p = '/'; }
+    }
+    if (r->op == LOG_REPLACE) {
+        char tmp[sizeof(path) + 4];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        FILE *out = fopen(tmp, "wb");
+        if (!out) return 0;
+        int complete = readLogData(log, r, rel, out, NULL);
+        int written = !ferror(out);
+        if (fclose(out) != 0) written = 0;
+        if (!written || !complete) { remove(tmp); return written ? -1 : 0; }
+        remove(path);
+        return rename(tmp, path) == 0;
+    }
+    unsigned char data[REPL_MAX_WRITE];
+    if (r->op != LOG_WRITE_AT || r->dataLen > sizeof(data) || !readLogData(log, r, rel, NULL, data)) return -1;
+    FILE *f = fopen(path, "rb+");
+    if (!f) f = fopen(path, "wb+");
+    if (!f) return 0;
+    int ok = fseek64(f, r->offset, SEEK_SET) == 0 && fwrite(data, 1, (size_t)r->dataLen, f) == r->dataLen;
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+static void replicaResync(struct ReplicaState *st, const struct LogHeader *h) {
+    st->epoch = h->epoch;
+    st->appliedSeq = 0;
+    st->appliedOffset = h->base;
+    st->appliedTime = 0;
+}
+
+// Applies every complete record past st->appliedOffset. Returns the number
+// applied, or -1 if the leader log cannot be read. A log with a different
+// epoch, or one whose record at appliedOffset no longer parses although the
+// header says more follow, has been recreated: replay it from the start.
+static long replicaApplyLog(struct ReplicaState *st) {
+    FILE *f = fopen(REPL_LOG, "rb");
+    if (!f) return -1;
+    struct LogHeader h;
+    if (!readLogHeader(f, &h)) { fclose(f); return -1; }
+    int resynced = h.epoch != st->epoch || st->appliedOffset < h.base, failed = 0;
+    if (resynced && h.base > (long long)sizeof(h) && h.epoch != st->epoch) {
+        // Trimmed logs no longer hold the base copy of this epoch.
+        printf("Replica: %s no longer holds a full copy; start the replication log again.\n", REPL_LOG);
+        fclose(f);
+        return -1;
+    }
+    if (resynced) replicaResync(st, &h);
+    long applied = 0;
+    while (1) {
+        fseek64(f, logPos(&h, st->appliedOffset), SEEK_SET);
+        struct LogRecord r; char path[PATH_LEN];
+        while (readLogHead(f, &r, path, sizeof(path))) {
+            int ok = replicaApply(f, &r, path);
+            if (ok < 0) break;
+            if (!ok) { printf("Replica: unable to apply change %llu to %s.\n", r.seq, path); failed = 1; break; }
+            st->appliedSeq = r.seq;
+            st->appliedTime = r.time;
+            st->appliedOffset = logOffset(&h, ftell64(f));
+            applied++;
+        }
+        if (failed || st->appliedSeq >= h.lastSeq) break;
+        if (resynced) { printf("Replica: %s is unreadable after seq %llu.\n", REPL_LOG, st->appliedSeq); break; }
+        replicaResync(st, &h);
+        resynced = 1;
+    }
+    fclose(f);
+    if (applied > 0 || resynced) replicaSaveState(st);
+    return applied;
+}
+
+// The follower and an admin serving reports may both catch the replica up;
+// replica.lock keeps them from applying (and renaming temporaries) at once.
+// The state is reloaded under the lock as the other process may have moved it.
+static long replicaCatchUp(struct ReplicaState *st) {
+    makeDir(REPLICA_DIR);
+    struct FileLock lk;
+    if (!lockAcquire(&lk, REPLICA_LOCK)) return -1;
+    replicaLoadState(st);
+    long applied = replicaApplyLog(st);
+    lockRelease(&lk);
+    return applied;
+}
+
+// Lag of the replica behind the leader log, in records and in seconds since
+// the oldest change it has not applied yet. If that change cannot be read
+// the replica needs a resync; count from the last change it did apply.
+static void replicaLag(const struct ReplicaState *st, unsigned long long *records, long long *seconds) {
+    *records = 0; *seconds = 0;
+    FILE *f = fopen(REPL_LOG, "rb");
+    if (!f) return;
+    struct LogHeader h;
+    if (!readLogHeader(f, &h)) { fclose(f); return; }
+    int sameLog = h.epoch == st->epoch && st->appliedOffset >= h.base;
+    unsigned long long applied = sameLog ? st->appliedSeq : 0;
+    long long oldest = 0;
+    struct LogRecord r;
+    if (fseek64(f, logPos(&h, sameLog ? st->appliedOffset : h.base), SEEK_SET) == 0
+        && fread(&r, sizeof(r), 1, f) && r.magic == REPL_MAGIC && r.seq > applied) {
+        *records = h.lastSeq >= r.seq ? h.lastSeq - r.seq + 1 : 1;
+        oldest = r.time;
+    } else if (h.lastSeq > applied) {
+        *records = h.lastSeq - applied;
+        oldest = st->appliedTime ? st->appliedTime : h.lastTime;
+    }
+    if (oldest) {
+        *seconds = (long long)difftime(time(NULL), (time_t)oldest);
+        if (*seconds < 0) *seconds = 0;
+    }
+    fclose(f);
+}
+
+static void replicationStatus(void) {
+    struct LogHeader h;
+    if (!journalReadHeader(&h)) printf("Replication log is not active.\n");
+    else printf("Leader: seq %llu, log %lld bytes.\n", h.lastSeq, logPos(&h, h.endOffset));
+    struct ReplicaState st; replicaLoadState(&st);
+    unsigned long long recs; long long secs;
+    replicaLag(&st, &recs, &secs);
+    printf("Replica (%s/): applied seq %llu.\n", REPLICA_DIR, st.appliedSeq);
+    printf("Lag: %llu change(s), %lld second(s).\n", recs, secs);
+}
+
+// Bounded staleness: serve from the replica as-is while it is within
+// REPLICA_MAX_LAG_SEC of the leader, otherwise catch it up first. Returns 0
+// (after saying why) if it is still too far behind to serve a report.
+static int replicaEnsureFresh(void) {
+    struct ReplicaState st; replicaLoadState(&st);
+    unsigned long long recs; long long secs;
+    replicaLag(&st, &recs, &secs);
+    if (recs == 0 || secs <= REPLICA_MAX_LAG_SEC) return 1;
+    if (replicaCatchUp(&st) < 0) printf("Replica: unable to read %s.\n", REPL_LOG);
+    replicaLag(&st, &recs, &secs);
+    if (recs == 0 || secs <= REPLICA_MAX_LAG_SEC) return 1;
+    printf("Replica is %llu change(s), %lld second(s) behind the leader; report not served.\n", recs, secs);
+    return 0;
+}
+
+static void followReplicationLog(void) {
+    printf("Following %s into %s/ (Ctrl+C to stop).\n", REPL_LOG, REPLICA_DIR);
+    struct ReplicaState st; replicaLoadState(&st);
+    int waiting = 0;
+    while (1) {
+        long n = replicaCatchUp(&st);
+        if (n < 0 && !waiting) { printf("Waiting for %s...\n", REPL_LOG); waiting = 1; }
+        if (n > 0) {
+            unsigned long long recs; long long secs;
+            replicaLag(&st, &recs, &secs);
+            printf("Applied %ld change(s), now at seq %llu. Lag: %llu change(s), %lld second(s).\n",
+                   n, st.appliedSeq, recs, secs);
+            waiting = 0;
+        }
+        sleepMs(REPLICA_POLL_MS);
+    }
+}
+
+static void replicaReportsMenu(void) {
+    struct ReplicaState st; replicaLoadState(&st);
+    if (replicaCatchUp(&st) < 0 && st.appliedSeq == 0) { printf("No replica available. Start the replication log first.\n"); return; }
+    setDataRoot(REPLICA_DIR);
+    while (1) {
+        printf("\n--- Reports From Replica (branch %s) ---\n", g_branch);
+        printf("1. View All Books (sorted)\n2. Search Book (keyword)\n3. View Issued Report\n4. Check Overdue Books\n5. Search All Branches\n6. Overdue Across Branches\n7. Replication Status\n8. Back\nEnter choice: ");
+        int ch; if (!readInt(&ch)) { printf("Invalid.\n"); continue; }
+        if (ch == 8) break;
+        if (ch != 7 && !replicaEnsureFresh()) { pauseForUser(); continue; }
+        switch (ch) {
+            case 1: viewAllBooksSorted(); break;
+            case 2: searchByKeyword(); break;
+            case 3: viewIssuedReport(); break;
+            case 4: checkOverdue(); break;
+            case 5: searchAllBranches(); break;
+            case 6: overdueAllBranches(); break;
+            case 7: replicationStatus(); break;
+            default: printf("Invalid.\n");
+        }
+        pauseForUser();
+    }
+    setDataRoot("");
+}
+
 static void adminMenu(void) {
     while (1) {
         printf("\n--- Admin Menu ---\n");
-        printf("1. Add Book\n2. Update Book\n3. Delete Book\n4. View All Books (sorted)\n5. View Issued Report\n6. Check Overdue Books\n7. Add Student\n8. Remove Student\n9. Backup (all)\n10. Restore (all)\n11. Change Admin Password\n12. Reset Admin Password to Default\n13. Search Student by Name\n14. View Student History\n15. Export Overdue Report CSV\n16. Back\nEnter choice: ");
+        printf("1. Add Book\n2. Update Book\n3. Delete Book\n4. View All Books (sorted)\n5. View Issued Report\n6. Check Overdue Books\n7. Add Student\n8. Remove Student\n9. Backup (all)\n10. Restore (all)\n11. Change Admin Password\n12. Reset Admin Password to Default\n13. Search Student by Name\n14. View Student History\n15. Export Overdue Report CSV\n16. Add Branch\n17. Search All Branches\n18. Overdue Across Branches\n19. Start Replication Log\n20. Replication Status\n21. Reports From Replica\n22. Back\nEnter choice: ");
         int ch; if (!readInt(&ch)) { printf("Invalid.\n"); continue; }
         switch (ch) {
             case 1: addBook(); break;
@@ -693,7 +2347,13 @@ static void adminMenu(void) {
                 checkOverdue();
                 break;
             }
-            case 16: return;
+            case 16: addBranch(); break;
+            case 17: searchAllBranches(); break;
+            case 18: overdueAllBranches(); break;
+            case 19: startReplicationLog(); break;
+            case 20: replicationStatus(); break;
+            case 21: replicaReportsMenu(); break;
+            case 22: return;
             default: printf("Invalid.\n");
         }
         pauseForUser();
@@ -703,8 +2363,8 @@ static void adminMenu(void) {
 static void studentMenu(int student_id) {
     char sname[120]; studentExists(student_id, sname);
     while (1) {
-        printf("\n--- Student Menu (ID %d) ---\n", student_id);
-        printf("1. View All Books\n2. View Available Books\n3. Search Book (keyword)\n4. Issue Book\n5. Return Book\n6. View My Issued Books\n7. My History\n8. Back\nEnter choice: ");
+        printf("\n--- Student Menu (ID %d, branch %s) ---\n", student_id, g_branch);
+        printf("1. View All Books\n2. View Available Books\n3. Search Book (keyword)\n4. Issue Book\n5. Return Book\n6. View My Issued Books\n7. My History\n8. Borrow From Another Branch\n9. Return Inter-branch Loan\n10. Back\nEnter choice: ");
         int ch; if (!readInt(&ch)) { printf("Invalid.\n"); continue; }
         switch (ch) {
             case 1: viewAllBooksSorted(); break;
@@ -714,17 +2374,26 @@ static void studentMenu(int student_id) {
             case 5: returnBookByStudent(student_id); break;
             case 6: viewStudentIssued(student_id); break;
             case 7: studentHistory(student_id); break;
-            case 8: return;
+            case 8: borrowFromBranch(student_id); break;
+            case 9: returnBranchLoan(student_id); break;
+            case 10: return;
             default: printf("Invalid.\n");
         }
         pauseForUser();
     }
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--follow") == 0) {
+        followReplicationLog();
+        return 0;
+    }
+    journalOpen();
+    migrateDataFormat();
     ensureDataFilesExist();
+    indexesOpen();
     while (1) {
-        printf("\n--- Library System ---\n1. Student Mode\n2. Admin Mode\n3. Exit\nEnter choice: ");
+        printf("\n--- Library System (branch %s) ---\n1. Student Mode\n2. Admin Mode\n3. Switch Branch\n4. Exit\nEnter choice: ", g_branch);
         int mode; if (!readInt(&mode)) { printf("Invalid choice.\n"); continue; }
         if (mode == 1) {
             printf("Enter Student ID: ");
@@ -737,6 +2406,10 @@ int main(void) {
             if (adminLogin()) adminMenu();
             else printf("Access denied.\n");
         } else if (mode == 3) {
+            switchBranch();
+        } else if (mode == 4) {
+            indexesCheckpoint();
+            journalCheckpoint();
             printf("Exiting.\n"); break;
         } else printf("Invalid choice.\n");
     }